@@ -1,25 +1,48 @@
 #include "benchmark/benchmark.h"
 
+#include "spice/detail/csr.h"
 #include "spice/topology.h"
 #include "spice/util/range.h"
+#include "spice/util/thread_pool.h"
 
 using namespace spice;
 
-static void adjlist(benchmark::State& state) {
+static adj_list random_adjlist() {
 	adj_list adj;
 	for (Int i : util::range(10'000'000))
 		adj.connect(rand() % 10'000, i), (void)i;
 
 	adj(10'000, std::numeric_limits<Int32>::max() - 1);
+	return adj;
+}
+
+// Sort-based construction via edge_stream
+static void adjlist_sorted(benchmark::State& state) {
+	adj_list adj = random_adjlist();
 
 	std::vector<Int> offsets(adj.src_count + 1);
 	std::vector<Int32> neighbors(adj.size());
 
 	for (auto _ : state) {
-		static_cast<Topology&>(adj).generate(offsets, neighbors, {1337});
+		edge_stream es(offsets, neighbors);
+		static_cast<Topology&>(adj).generate(es, {1337});
+		es.flush();
 	}
 }
-BENCHMARK(adjlist)->Unit(benchmark::kMillisecond);
+BENCHMARK(adjlist_sorted)->Unit(benchmark::kMillisecond);
+
+static void adjlist(benchmark::State& state) {
+	adj_list adj = random_adjlist();
+
+	std::vector<Int> offsets(adj.src_count + 1);
+	std::vector<Int32> neighbors(adj.size());
+
+	util::thread_pool pool(state.range(0));
+	for (auto _ : state) {
+		static_cast<Topology&>(adj).generate(offsets, neighbors, {1337}, pool);
+	}
+}
+BENCHMARK(adjlist)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond);
 
 static void fixedprob(benchmark::State& state) {
 	fixed_probability fprob(0.1);
@@ -28,8 +51,28 @@ static void fixedprob(benchmark::State& state) {
 	std::vector<Int> offsets(fprob.src_count + 1);
 	std::vector<Int32> neighbors(fprob.size());
 
+	util::thread_pool pool(state.range(0));
+	for (auto _ : state) {
+		fprob.generate(offsets, neighbors, {1337}, pool);
+	}
+}
+BENCHMARK(fixedprob)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond);
+
+// Walking all rows of a graph with the given density (in percent), stored as lists or as bitsets
+template <bool Dense>
+static void csr_neighbors(benchmark::State& state) {
+	fixed_probability fprob(state.range(0) / 100.0);
+	util::thread_pool pool;
+	spice::detail::csr<> c(fprob(1'000, 10'000), {1337}, pool, Dense ? 0.0 : 2.0);
+
 	for (auto _ : state) {
-		fprob.generate(offsets, neighbors, {1337});
+		Int sum = 0;
+		for (Int src : util::range(1'000))
+			for (auto edge : c.neighbors(src))
+				sum += edge.first;
+		benchmark::DoNotOptimize(sum);
 	}
+	state.SetItemsProcessed(state.iterations() * fprob.size());
 }
-BENCHMARK(fixedprob)->Unit(benchmark::kMillisecond);
\ No newline at end of file
+BENCHMARK(csr_neighbors<false>)->Arg(10)->Arg(30)->Arg(60)->Unit(benchmark::kMicrosecond);
+BENCHMARK(csr_neighbors<true>)->Arg(10)->Arg(30)->Arg(60)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
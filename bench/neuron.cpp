@@ -0,0 +1,116 @@
+#include "benchmark/benchmark.h"
+
+#include "spice/detail/neuron_population.h"
+#include "spice/neurons.h"
+#include "spice/util/random.h"
+#include "spice/util/simd.h"
+#include "spice/util/thread_pool.h"
+
+using namespace spice;
+using namespace spice::util;
+
+enum class layout { aos, soa, batch };
+
+// The LIF neuron from samples/vogels.cpp, stored as an array of structs (aos), a structure of
+// arrays (soa), and a structure of arrays updated in batches (batch).
+template <layout L>
+struct lif {
+	struct neuron {
+		float V     = -0.06;
+		float Gex   = 0;
+		float Gin   = 0;
+		Int32 Twait = 0;
+	};
+
+	struct batch {
+		simd<float> V;
+		simd<float> Gex;
+		simd<float> Gin;
+		simd<Int32> Twait;
+	};
+
+	static constexpr Int32 Tref    = 50;
+	static constexpr float Vrest   = -0.06;
+	static constexpr float Vthres  = -0.05;
+	static constexpr float TmemInv = 1.0f / 0.02;
+	static constexpr float Eex     = 0.0;
+	static constexpr float Ein     = -0.08;
+	static constexpr float Ibg     = 0.02;
+	static constexpr float TexInv  = 1.0f / 0.005;
+	static constexpr float TinInv  = 1.0f / 0.01;
+
+	bool update(neuron& n, float const dt, auto&) const requires(L != layout::batch) {
+		bool spiked = false;
+		if (--n.Twait <= 0) {
+			if (n.V > Vthres) {
+				n.V     = Vrest;
+				n.Twait = Tref;
+				spiked  = true;
+			} else
+				n.V += ((Vrest - n.V) + n.Gex * (Eex - n.V) + n.Gin * (Ein - n.V) + Ibg) *
+				       (dt * TmemInv);
+		}
+
+		n.Gex -= n.Gex * (dt * TexInv);
+		n.Gin -= n.Gin * (dt * TinInv);
+
+		return spiked;
+	}
+
+	UInt32 update(batch& b, float const dt, auto&) const requires(L == layout::batch) {
+		auto const ready  = --b.Twait <= 0;
+		auto const spiked = ready & (b.V > Vthres);
+
+		auto const V = b.V + ((Vrest - b.V) + b.Gex * (Eex - b.V) + b.Gin * (Ein - b.V) + Ibg) *
+		                         (dt * TmemInv);
+		b.V     = spiked ? Vrest : ready ? V : b.V;
+		b.Twait = spiked ? Tref : b.Twait;
+
+		b.Gex -= b.Gex * (dt * TexInv);
+		b.Gin -= b.Gin * (dt * TinInv);
+
+		return to_bitmask(spiked);
+	}
+};
+BOOST_HANA_ADAPT_STRUCT(lif<layout::soa>::neuron, V, Gex, Gin, Twait);
+BOOST_HANA_ADAPT_STRUCT(lif<layout::batch>::neuron, V, Gex, Gin, Twait);
+BOOST_HANA_ADAPT_STRUCT(lif<layout::batch>::batch, V, Gex, Gin, Twait);
+static_assert(!SoANeuron<lif<layout::aos>>);
+static_assert(SoANeuron<lif<layout::soa>> && !PerBatchUpdate<lif<layout::soa>>);
+static_assert(PerBatchUpdate<lif<layout::batch>>);
+
+template <layout L>
+static void update_lif(benchmark::State& state) {
+	seed_seq seed{1337};
+	thread_pool pool;
+	spice::detail::neuron_population<lif<L>> pop({}, state.range(0), seed, 1);
+
+	for (auto _ : state)
+		pop.update(1e-4, seed, pool);
+}
+BENCHMARK(update_lif<layout::aos>)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(update_lif<layout::soa>)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(update_lif<layout::batch>)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+
+// Poisson input as in samples/brunel.cpp: one random number per neuron vs. sampling spike indices
+struct poisson {
+	float rate;
+	bool update(float const dt, auto& rng) const {
+		return generate_canonical<float>(rng) < rate * dt;
+	}
+};
+
+template <class Neur>
+static void update_poisson(benchmark::State& state) {
+	seed_seq seed{1337};
+	thread_pool pool;
+	spice::detail::neuron_population<Neur> pop({20}, state.range(0), seed, 1);
+
+	for (auto _ : state)
+		pop.update(1e-4, seed, pool);
+}
+BENCHMARK(update_poisson<poisson>)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(update_poisson<poisson_source>)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMicrosecond);
\ No newline at end of file
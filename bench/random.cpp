@@ -0,0 +1,59 @@
+#include <span>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "spice/util/random.h"
+
+using namespace spice::util;
+
+// Fills state.range(0) floats per iteration: one scalar draw per number vs. the batch interface
+// (which uses multiple lanes if the generator has them).
+template <class RNG>
+static void canonical_scalar(benchmark::State& state) {
+	RNG rng({1337});
+	std::vector<float> x(state.range(0));
+
+	for (auto _ : state) {
+		for (float& f : x)
+			f = generate_canonical<float>(rng);
+		benchmark::DoNotOptimize(x.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(canonical_scalar<xoroshiro64_128p>)->Arg(10'000);
+BENCHMARK(canonical_scalar<philox4x32_10>)->Arg(10'000);
+
+template <class RNG>
+static void canonical_batch(benchmark::State& state) {
+	RNG rng({1337});
+	std::vector<float> x(state.range(0));
+
+	for (auto _ : state) {
+		generate_canonical<float>(rng, std::span(x));
+		benchmark::DoNotOptimize(x.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(canonical_batch<xoroshiro64_128p>)->Arg(10'000);
+BENCHMARK(canonical_batch<xoroshiro64_128p_lanes<2>>)->Arg(10'000);
+BENCHMARK(canonical_batch<xoroshiro64_128p_lanes<4>>)->Arg(10'000);
+
+template <class RNG, bool Batch>
+static void exponential(benchmark::State& state) {
+	RNG rng({1337});
+	exponential_distribution<float> dist(0.2);
+	std::vector<float> x(state.range(0));
+
+	for (auto _ : state) {
+		if constexpr (Batch)
+			dist(rng, std::span(x));
+		else
+			for (float& f : x)
+				f = dist(rng);
+		benchmark::DoNotOptimize(x.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(exponential<xoroshiro64_128p, false>)->Arg(10'000);
+BENCHMARK(exponential<xoroshiro64_128p_lanes<4>, true>)->Arg(10'000);
\ No newline at end of file
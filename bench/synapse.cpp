@@ -0,0 +1,69 @@
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "spice/detail/synapse_population.h"
+#include "spice/util/thread_pool.h"
+
+using namespace spice;
+using namespace spice::util;
+
+struct source {
+	bool update(float, auto&) const { return false; }
+};
+
+struct lif {
+	struct neuron {
+		float V     = 0;
+		Int32 Twait = 0;
+	};
+	bool update(neuron&, float, auto&) const { return false; }
+};
+
+struct fixed_weight {
+	float weight;
+	void deliver(lif::neuron& to) const { to.V += weight; }
+};
+
+// All of 200 sources spike, every one connects to 5% of the destinations: Every destination
+// receives 10 spikes on average, like in large networks with dense connectivity.
+template <delivery Mode>
+static void deliver(benchmark::State& state) {
+	Int const src_count = 200;
+	Int const dst_count = state.range(0);
+
+	using synapse_population = spice::detail::synapse_population<fixed_weight, source, lif>;
+	seed_seq seed{1337};
+	thread_pool pool;
+	fixed_probability fprob(0.05);
+	Int const bucket_size = Mode == delivery::bucketed ? synapse_population::default_bucket_size : 0;
+	synapse_population syn({1e-4}, fprob(src_count, dst_count), seed, 1, pool, bucket_size,
+	                       Mode == delivery::procedural);
+
+	std::vector<lif::neuron> neurons(dst_count);
+	std::vector<Int32> spikes;
+	for (Int32 i = 0; i < src_count; i++)
+		spikes.push_back(i);
+
+	for (auto _ : state)
+		syn.deliver(0, 1e-4, spikes, nullptr, src_count, neurons.data(), dst_count, {}, pool);
+	state.SetItemsProcessed(state.iterations() * dst_count * 10);
+}
+BENCHMARK(deliver<delivery::scatter>)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Arg(4'000'000)
+    ->Arg(16'000'000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(deliver<delivery::bucketed>)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Arg(4'000'000)
+    ->Arg(16'000'000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(deliver<delivery::procedural>)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Arg(4'000'000)
+    ->Arg(16'000'000)
+    ->Unit(benchmark::kMicrosecond);
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "spice/snn.h"
+#include "spice/util/transport.h"
+
+using namespace spice;
+using namespace spice::util;
+
+/*
+The Brunel model (see brunel.cpp), split across multiple processes ("ranks"):
+Every rank builds the same network but only updates its own slice of each population and
+delivers spikes to it. After every min_delay steps the ranks exchange the spikes of their
+slices. The resulting spikes are identical to those of a single process.
+
+Usage: brunel_distributed [ranks = 2] [steps = 1000]
+*/
+
+struct poisson {
+	bool update(float dt, auto& rng) const {
+		float const firing_rate = 20; // Hz
+		return util::generate_canonical<float>(rng) < (firing_rate * dt);
+	}
+};
+
+struct lif {
+	struct neuron {
+		float V   = 0;
+		int Twait = 0;
+	};
+
+	bool update(neuron& n, float dt, auto) const {
+		float const TmemInv = 1.0 / 0.02; // s
+		float const Vrest   = 0.0;        // v
+		int const Tref      = 20;         // dt
+		float const Vthres  = 0.02;       // v
+
+		if (--n.Twait <= 0) {
+			if (n.V > Vthres) {
+				n.V     = Vrest;
+				n.Twait = Tref;
+				return true;
+			}
+
+			n.V += (Vrest - n.V) * (dt * TmemInv);
+		}
+		return false;
+	}
+};
+
+struct fixed_weight {
+	float weight;
+	void deliver(lif::neuron& to) const { to.V += weight; }
+};
+
+int main(int argc, char** argv) {
+	Int const ranks = argc > 1 ? std::atoi(argv[1]) : 2;
+	Int const steps = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	int const N       = 20000;
+	float const dt    = 1e-4;
+	float const delay = 15e-4;
+
+	// Everything after fork() runs in all ranks. The network has to be distributed before any
+	// populations are added.
+	auto comm = socket_transport::fork(ranks);
+
+	snn brunel(dt, delay, {1337});
+	brunel.distribute(*comm);
+
+	auto P = brunel.add_population<poisson>(N / 2);
+	auto E = brunel.add_population<lif>(N * 4 / 10);
+	auto I = brunel.add_population<lif>(N / 10);
+
+	brunel.connect<fixed_weight>(P, E, fixed_probability(0.1), delay, {2.0 / N});
+	brunel.connect<fixed_weight>(P, I, fixed_probability(0.1), delay, {2.0 / N});
+	brunel.connect<fixed_weight>(E, E, fixed_probability(0.1), delay, {2.0 / N});
+	brunel.connect<fixed_weight>(E, I, fixed_probability(0.1), delay, {2.0 / N});
+	brunel.connect<fixed_weight>(I, E, fixed_probability(0.1), delay, {-10.0 / N});
+	brunel.connect<fixed_weight>(I, I, fixed_probability(0.1), delay, {-10.0 / N});
+
+	// All ranks hold the spikes of all neurons, so any rank may record them. run() synchronizes
+	// the ranks once per min_delay (= delay / dt) steps, and spikes(age) reaches back as far.
+	Int const chunk  = 15;
+	Int spikes       = 0;
+	auto const start = std::chrono::steady_clock::now();
+	for (Int i = 0; i < steps; i += chunk) {
+		Int const n = std::min(chunk, steps - i);
+		brunel.run(n);
+		for (Int age : range(n))
+			spikes += E->spikes(age).size() + I->spikes(age).size();
+	}
+	std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+	auto const& stats = comm->statistics();
+	std::ostringstream s;
+	s << "rank " << comm->rank() << '/' << comm->size() << ": " << elapsed.count() << "s, "
+	  << spikes << " spikes, " << stats.exchanges << " exchanges, " << stats.bytes
+	  << " bytes, " << stats.seconds << "s exchanging\n";
+	std::cerr << s.str();
+	return 0;
+}
\ No newline at end of file
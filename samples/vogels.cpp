@@ -15,18 +15,26 @@ struct lif {
 		Int32 Twait = 0;
 	};
 
-	bool update(neuron& n, float const dt, auto&) const {
-		Int32 const Tref    = 50;          // dt
-		float const Vrest   = -0.06;       // v
-		float const Vthres  = -0.05;       // v
-		float const TmemInv = 1.0f / 0.02; // s
-		float const Eex     = 0.0;         // v
-		float const Ein     = -0.08;       // v
-		float const Ibg     = 0.02;        // v
+	// The same state, for util::simd_width neurons at once
+	struct batch {
+		simd<float> V;
+		simd<float> Gex;
+		simd<float> Gin;
+		simd<Int32> Twait;
+	};
+
+	static constexpr Int32 Tref    = 50;          // dt
+	static constexpr float Vrest   = -0.06;       // v
+	static constexpr float Vthres  = -0.05;       // v
+	static constexpr float TmemInv = 1.0f / 0.02; // s
+	static constexpr float Eex     = 0.0;         // v
+	static constexpr float Ein     = -0.08;       // v
+	static constexpr float Ibg     = 0.02;        // v
 
-		float const TexInv = 1.0f / 0.005; // s
-		float const TinInv = 1.0f / 0.01;  // s
+	static constexpr float TexInv = 1.0f / 0.005; // s
+	static constexpr float TinInv = 1.0f / 0.01;  // s
 
+	bool update(neuron& n, float const dt, auto&) const {
 		bool spiked = false;
 		if (--n.Twait <= 0) {
 			if (n.V > Vthres) {
@@ -43,8 +51,28 @@ struct lif {
 
 		return spiked;
 	}
+
+	// Branch-free version of the above, takes precedence over it
+	UInt32 update(batch& b, float const dt, auto&) const {
+		auto const ready  = --b.Twait <= 0;
+		auto const spiked = ready & (b.V > Vthres);
+
+		auto const V = b.V + ((Vrest - b.V) + b.Gex * (Eex - b.V) + b.Gin * (Ein - b.V) + Ibg) *
+		                         (dt * TmemInv);
+		b.V     = spiked ? Vrest : ready ? V : b.V;
+		b.Twait = spiked ? Tref : b.Twait;
+
+		b.Gex -= b.Gex * (dt * TexInv);
+		b.Gin -= b.Gin * (dt * TinInv);
+
+		return to_bitmask(spiked);
+	}
 };
+// Store V, Gex, Gin, and Twait in separate arrays so lif can be updated in batches.
+BOOST_HANA_ADAPT_STRUCT(lif::neuron, V, Gex, Gin, Twait);
+BOOST_HANA_ADAPT_STRUCT(lif::batch, V, Gex, Gin, Twait);
 static_assert(CheckNeuron<lif>());
+static_assert(PerBatchUpdate<lif>);
 
 struct excitatory {
 	float weight;
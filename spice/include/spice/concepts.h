@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
 #include <concepts>
 #include <random>
 #include <span>
+#include <vector>
 
+#include "spice/util/simd.h"
+#include "spice/util/soa.h"
 #include "spice/util/stdint.h"
 #include "spice/util/type_traits.h"
 
@@ -18,6 +22,11 @@ concept StatefulNeuron = requires {
 	requires std::default_initializable<typename T::neuron>;
 };
 
+// Stateful neurons whose state is reflectable are stored as a structure of arrays (see
+// util::soa_vector). Opt in via e.g. BOOST_HANA_ADAPT_STRUCT(my_neuron::neuron, V, Twait);
+template <class T>
+concept SoANeuron = StatefulNeuron<T> && util::Reflectable<typename T::neuron>;
+
 template <class T>
 concept PerNeuronInit = requires(T const t, typename T::neuron& n, Int id, std::mt19937& rng) {
 	requires StatefulNeuron<T>;
@@ -41,6 +50,29 @@ concept PerNeuronUpdate = requires(T const t, float dt, std::mt19937& rng) {
 	             });
 };
 
+// Updates util::simd_width consecutive neurons at once. 'batch' holds one util::simd<F> per member
+// F of 'neuron' (see util::is_batch_of), 'rng' one random stream per lane. Returns a bitmask of
+// the lanes that spiked. Lanes beyond the end of the population are discarded.
+template <class T>
+concept PerBatchUpdate =
+    requires(T const t, typename T::batch& b, float dt,
+             std::array<std::mt19937, util::simd_width>& rng) {
+	    requires SoANeuron<T>;
+	    requires util::is_batch_of<typename T::batch, typename T::neuron>();
+	    { t.update(b, dt, rng) } -> std::convertible_to<UInt32>;
+    };
+
+// Emits the spikes of neurons [first, last) at once, e.g. by sampling spike indices instead of
+// visiting every neuron (see spice::poisson_source). Invoked once per block (see
+// detail::block_size) with a random stream of its own.
+template <class T>
+concept PerRangeUpdate = requires(T const t, Int first, Int last, float dt, std::mt19937& rng,
+                                  std::vector<Int32>& out_spikes) {
+	requires StatelessNeuron<T>;
+	requires !StatefulNeuron<T>;
+	t.update(first, last, dt, rng, out_spikes);
+};
+
 template <class T>
 concept PerPopulationUpdate = requires(T t, float dt, std::mt19937& rng,
                                        std::vector<Int32>& out_spikes) {
@@ -53,7 +85,9 @@ template <class T>
 concept Neuron = (PerPopulationUpdate<T> ?
                       util::none_of<StatefulNeuron<T>, PerNeuronUpdate<T>, PerNeuronInit<T>,
                                     PerPopulationInit<T>> :
-                      (StatelessNeuron<T> || StatefulNeuron<T>)&&PerNeuronUpdate<T> &&
+                      (StatelessNeuron<T> || StatefulNeuron<T>)&&(PerNeuronUpdate<T> ||
+                                                                  PerBatchUpdate<T> ||
+                                                                  PerRangeUpdate<T>)&&
                           util::up_to_one_of<PerNeuronInit<T>, PerPopulationInit<T>>);
 
 template <class T>
@@ -168,11 +202,19 @@ constexpr bool CheckNeuron() {
 	static_assert(StatelessNeuron<T>,
 	              "Every neuron must at least conform to the StatelessNeuron concept.");
 
-	constexpr bool has_update =
-	    detail::HasUpdate<T>(any, any) || detail::HasUpdate<T>(any, any, any);
+	// Neurons with both per-neuron and batch updates are ambiguous for 'any'
+	constexpr bool has_update = detail::HasUpdate<T>(any, any) ||
+	                            detail::HasUpdate<T>(any, any, any) ||
+	                            detail::HasUpdate<T>(any, any, any, any, any) || PerBatchUpdate<T>;
 	static_assert(has_update, "Every neuron must define an update() method.");
-	static_assert(!has_update || (PerNeuronUpdate<T> || PerPopulationUpdate<T>),
+	static_assert(!has_update || (PerNeuronUpdate<T> || PerBatchUpdate<T> || PerRangeUpdate<T> ||
+	                              PerPopulationUpdate<T>),
 	              "Your update() method has the wrong signautre.");
+	static_assert(!requires { typename T::batch; } || PerBatchUpdate<T>,
+	              "Your neuron defines a batch type but does not conform to the PerBatchUpdate "
+	              "concept. Make sure its state is reflectable (see SoANeuron), its batch holds "
+	              "one util::simd<> per member of its state (in the same order), and its "
+	              "update(batch&, dt, rng) method returns a bitmask.");
 	static_assert(
 	    !PerPopulationUpdate<T> || util::none_of<StatefulNeuron<T>, PerNeuronUpdate<T>,
 	                                             PerNeuronInit<T>, PerPopulationInit<T>>,
@@ -1,22 +1,99 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cmath>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "spice/topology.h"
 #include "spice/util/assert.h"
+#include "spice/util/checkpoint.h"
+#include "spice/util/numa.h"
 #include "spice/util/random.h"
 #include "spice/util/range.h"
 #include "spice/util/stdint.h"
+#include "spice/util/thread_pool.h"
 #include "spice/util/type_traits.h"
 
 namespace spice::detail {
+// Everything of a csr but the edges' payload, see csr::structure()
+struct csr_structure {
+	Int rows            = 0;
+	Int dst_first       = 0;
+	Int dst_last        = 0;
+	bool narrow_offsets = false;
+	bool narrow         = false;
+	bool dense          = false;
+	// Words per bitset row, including the sentinel
+	Int words = 0;
+	// Only one of each pair (and of neighbors/bitmap) is in use
+	std::vector<UInt32> offsets32;
+	std::vector<Int> offsets64;
+	std::vector<UInt16> neighbors16;
+	std::vector<Int32> neighbors32;
+	std::vector<UInt> bitmap;
+
+	// See snn::save()
+	void save(util::checkpoint_writer& out) const {
+		out.write_value(std::array<Int, 7>{rows, dst_first, dst_last, narrow_offsets, narrow, dense,
+		                                   words});
+		out.write(offsets32);
+		out.write(offsets64);
+		out.write(neighbors16);
+		out.write(neighbors32);
+		out.write(bitmap);
+	}
+	static std::shared_ptr<csr_structure> load(util::checkpoint_reader& in) {
+		auto result = std::make_shared<csr_structure>();
+		auto& s     = *result;
+
+		auto const header = in.read_value<std::array<Int, 7>>();
+		s.rows            = header[0];
+		s.dst_first       = header[1];
+		s.dst_last        = header[2];
+		s.narrow_offsets  = header[3];
+		s.narrow          = header[4];
+		s.dense           = header[5];
+		s.words           = header[6];
+		in.read(s.offsets32);
+		in.read(s.offsets64);
+		in.read(s.neighbors16);
+		in.read(s.neighbors32);
+		in.read(s.bitmap);
+
+		UInt const offsets = s.narrow_offsets ? s.offsets32.size() : s.offsets64.size();
+		if (offsets != (s.rows > 0 ? UInt(s.rows + 1) : 0))
+			throw std::runtime_error("csr_structure: corrupt checkpoint");
+		return result;
+	}
+};
+
+// Adjacency matrix in compressed sparse row format, with an optional payload T per edge.
+// Indices are stored as narrow as the graph allows: neighbors as UInt16 if there are at most
+// 2^16 destinations, offsets as UInt32 if there are less than 2^32 edges. Dense graphs (see
+// default_dense_density) store every row as a bitset of its neighbors instead, plus a sentinel
+// word with bit 0 set, which ends every scan for the next neighbor. Iterators hide the
+// difference, they always yield Int32 neighbors. Graphs with identical rows may share their
+// structure, which is copied on write.
 template <class T = void>
 class csr {
 public:
+	// Bitsets take 1 bit per destination, lists 16 (or 32) bits per neighbor, so bitsets are
+	// smaller from a density of 1/16 on. Scanning them for neighbors is slower than reading
+	// lists though, so they're reserved for graphs where they save at least 75% of the memory.
+	// Graphs with duplicate edges always use lists.
+	static constexpr double default_dense_density = 0.25;
+
 	template <bool Const>
 	class iterator_t {
 	public:
@@ -27,27 +104,41 @@ public:
 		using value_type        = std::pair<Int32, edge_t*>;
 
 		constexpr iterator_t() = default;
+		template <bool C = Const, class = std::enable_if_t<C>>
 		constexpr iterator_t(const iterator_t<false>& other) :
-		_dst(other._dst), _edge(other._edge) {}
+		_dst(other._dst),
+		_bits(other._bits),
+		_base(other._base),
+		_width(other._width),
+		_edge(other._edge) {}
 
-		constexpr value_type operator*() const {
+		// The format is the same for all iterators of a graph, so the branches are well predicted.
+		value_type operator*() const {
+			Int32 const dst = _width == 2 ? *static_cast<UInt16 const*>(_dst) :
+			                  _width == 4 ? *static_cast<Int32 const*>(_dst) :
+                                            _base + std::countr_zero(_bits);
 			if constexpr (std::is_void_v<T>)
-				return {*_dst, nullptr};
+				return {dst, nullptr};
 			else
-				return {*_dst, _edge};
+				return {dst, _edge};
 		}
 
-		constexpr bool operator==(const iterator_t& other) const { return _dst == other._dst; }
-		constexpr bool operator!=(const iterator_t& other) const { return _dst != other._dst; }
+		constexpr bool operator==(const iterator_t& other) const {
+			return _dst == other._dst && _bits == other._bits;
+		}
+		constexpr bool operator!=(const iterator_t& other) const { return !(*this == other); }
 
-		constexpr iterator_t& operator++() {
-			_dst++;
+		iterator_t& operator++() {
+			if (_width > 0)
+				_dst = static_cast<char const*>(_dst) + _width;
+			else
+				_next(_bits & (_bits - 1));
 			if constexpr (!std::is_void_v<T>)
 				_edge++;
 
 			return *this;
 		}
-		constexpr iterator_t operator++(int) {
+		iterator_t operator++(int) {
 			auto result = *this;
 			operator++();
 			return result;
@@ -55,47 +146,455 @@ public:
 
 	private:
 		friend class csr;
+		template <bool>
+		friend class iterator_t;
 
-		Int32 const* _dst = nullptr;
+		// Lists: the current neighbor, _width bytes wide. Bitsets (_width = 0): the current
+		// word, holding destinations [_base, _base + 64), and its yet to be visited bits.
+		void const* _dst = nullptr;
+		UInt _bits       = 0;
+		Int32 _base      = 0;
+		Int32 _width     = 0;
 		[[no_unique_address]] util::optional_t<edge_t*, !std::is_void_v<T>> _edge{};
 
-		constexpr iterator_t(Int32 const* dst) : _dst(dst) {}
-		template <class U = T, class = std::enable_if_t<!std::is_void_v<U>>>
-		constexpr iterator_t(Int32 const* dst, edge_t* edge) : _dst(dst), _edge(edge) {}
+		constexpr iterator_t(void const* dst, Int32 const width, edge_t* edge) :
+		_dst(dst), _width(width) {
+			if constexpr (!std::is_void_v<T>)
+				_edge = edge;
+		}
+		// Points to the first neighbor >= 'base' in the bitset row containing 'word', which
+		// holds destinations [base - base % 64, ...)
+		iterator_t(UInt const* word, Int32 const base, edge_t* edge) :
+		iterator_t(static_cast<void const*>(word), 0, edge) {
+			_base = base - base % 64;
+			_next(*word & (~0_u64 << (base % 64)));
+		}
+
+		// Moves on to the next set bit, starting with 'bits' of the current word
+		void _next(UInt bits) {
+			auto word = static_cast<UInt const*>(_dst);
+			while (!bits) {
+				bits = *++word;
+				_base += 64;
+			}
+			_dst  = word;
+			_bits = bits;
+		}
 	};
 	using iterator       = iterator_t<false>;
 	using const_iterator = iterator_t<true>;
 
-	csr(Topology& c, util::seed_seq const& seed) {
-		_offsets.resize(c.src_count > 0 ? c.src_count + 1 : 0);
-		_neighbors.resize(c.size());
+	// Uses bitsets if at least 'dense_density' of all possible edges exist
+	csr(Topology& c, util::seed_seq const& seed, util::thread_pool& pool,
+	    double const dense_density = default_dense_density) :
+	csr(c, 0, c.dst_count, seed, pool, dense_density) {}
+
+	// Only the edges targeting [dst_first, dst_last), as if filter_destinations() had been
+	// called, but without ever generating the others (see Topology::generate_slice()). Bitsets
+	// span all destinations, so slices always use lists.
+	csr(Topology& c, Int const dst_first, Int const dst_last, util::seed_seq const& seed,
+	    util::thread_pool& pool, double const dense_density = default_dense_density) :
+	_s(std::make_shared<csr_structure>()) {
+		SPICE_PRE(0 <= dst_first && dst_first <= dst_last && dst_last <= c.dst_count);
+		_s->rows      = c.src_count;
+		_s->dst_first = dst_first;
+		_s->dst_last  = dst_last;
+
+		// Chosen up front, so that topologies generate straight into the narrow neighbors
+		_s->narrow = c.dst_count <= std::numeric_limits<UInt16>::max() + 1;
+
+		std::vector<Int> offsets(c.src_count > 0 ? c.src_count + 1 : 0);
+		bool const all = dst_first == 0 && dst_last == c.dst_count;
+		if (_s->narrow)
+			_generate(c, all, seed, pool, dense_density, offsets, _s->neighbors16);
+		else
+			_generate(c, all, seed, pool, dense_density, offsets, _s->neighbors32);
+
+		Int const edges    = offsets.empty() ? 0 : offsets.back();
+		_s->narrow_offsets = edges <= std::numeric_limits<UInt32>::max();
+		if (_s->narrow_offsets)
+			_s->offsets32.assign(offsets.begin(), offsets.end());
+		else
+			_s->offsets64 = std::move(offsets);
+
 		if constexpr (!std::is_void_v<T>)
-			_edges.resize(_neighbors.size());
+			_edges.resize(edges);
+	}
 
-		c.generate(_offsets, _neighbors, seed);
-		SPICE_INV(std::is_sorted(_offsets.begin(), _offsets.end()));
+	// A graph without any rows over 'dst_count' destinations. It stores nothing but still keeps
+	// track of filter_destinations() and partition(), see delivery::procedural.
+	explicit csr(Int const dst_count) : _s(std::make_shared<csr_structure>()) {
+		_s->dst_last = dst_count;
 	}
 
-	util::range_t<iterator> neighbors(Int const src) {
-		SPICE_INV(0 <= src && src + 1 < _offsets.size());
+	// A graph with the same rows as the one 'structure' was taken from, and default-initialized
+	// edges
+	explicit csr(std::shared_ptr<csr_structure> structure) : _s(std::move(structure)) {
+		SPICE_PRE(_s);
+		if constexpr (!std::is_void_v<T>)
+			_edges.resize(_s->rows > 0 ? _offset(_s->rows) : 0);
+	}
 
-		Int const first = _offsets[src];
-		Int const last  = _offsets[src + 1];
+	std::shared_ptr<csr_structure> const& structure() const { return _s; }
 
-		if constexpr (std::is_void_v<T>)
-			return {_neighbors.data() + first, _neighbors.data() + last};
-		else
-			return {{_neighbors.data() + first, _edges.data() + first},
-			        {_neighbors.data() + last, _edges.data() + last}};
+	// Only the edges' payload, the structure is saved separately (see csr_structure::save()).
+	// The graph must have been created from the same structure. Throws std::runtime_error if
+	// the payload can't be copied as is.
+	void save(util::checkpoint_writer& out) const {
+		if constexpr (std::is_trivially_copyable_v<T>)
+			out.write(_edges);
+		else if constexpr (!std::is_void_v<T>)
+			throw std::runtime_error("csr: edges aren't trivially copyable");
+	}
+	void load(util::checkpoint_reader& in) {
+		if constexpr (std::is_trivially_copyable_v<T>)
+			in.read(std::span(_edges));
+		else if constexpr (!std::is_void_v<T>)
+			throw std::runtime_error("csr: edges aren't trivially copyable");
+		_parts = 1;
+		_splits.clear();
+	}
+
+	util::range_t<iterator> neighbors(Int const src) {
+		SPICE_INV(0 <= src && src < _s->rows);
+
+		return _neighbors_range(src, _offset(src), _offset(src + 1), _s->dst_first, _s->dst_last);
 	}
 
 	util::range_t<const_iterator> neighbors(Int const src) const {
-		return const_cast<csr*>(this)->neighbors(src);
+		auto const r = const_cast<csr*>(this)->neighbors(src);
+		return {r.begin(), r.end()};
+	}
+
+	// Splits every row into 'parts' destination blocks s.t. neighbors(src, part) only contains
+	// neighbors in [first + part * n / parts, first + (part + 1) * n / parts), where [first,
+	// first + n) are the destinations kept by filter_destinations() (all of them by default).
+	void partition(Int const parts) {
+		SPICE_PRE(parts >= 1);
+
+		if (parts == _parts)
+			return;
+
+		_parts = parts;
+		_splits.resize(parts > 1 ? _s->rows * (parts + 1) : 0);
+		for (Int const src : util::range(parts > 1 ? _s->rows : 0))
+			for (Int const part : util::range(parts + 1))
+				_splits[src * (parts + 1) + part] =
+				    _lower_bound(src,
+				                 _s->dst_first + part * (_s->dst_last - _s->dst_first) / parts) -
+				    _offset(src);
+	}
+
+	// Removes all edges whose destination lies outside [first, last)
+	void filter_destinations(Int const first, Int const last) {
+		SPICE_PRE(_s->dst_first <= first && first <= last && last <= _s->dst_last);
+		_own();
+
+		Int count = 0;
+		for (Int const src : util::range(_s->rows)) {
+			Int const lo = _lower_bound(src, first);
+			Int const hi = _lower_bound(src, last);
+
+			_set_offset(src, count);
+			if (_s->dense) {
+				UInt* const row = _s->bitmap.data() + src * _s->words;
+				for (Int const w : util::range(_s->words - 1))
+					row[w] &= _bits(first - w * 64, last - w * 64);
+			} else
+				_visit_neighbors([&](auto& neighbors) {
+					std::copy(neighbors.begin() + lo, neighbors.begin() + hi,
+					          neighbors.begin() + count);
+				});
+			if constexpr (!std::is_void_v<T>)
+				std::copy(_edges.begin() + lo, _edges.begin() + hi, _edges.begin() + count);
+			count += hi - lo;
+		}
+		if (_s->rows > 0)
+			_set_offset(_s->rows, count);
+
+		if (!_s->dense)
+			_visit_neighbors([&](auto& neighbors) {
+				neighbors.resize(count);
+				neighbors.shrink_to_fit();
+			});
+		if constexpr (!std::is_void_v<T>) {
+			_edges.resize(count);
+			_edges.shrink_to_fit();
+		}
+
+		_s->dst_first = first;
+		_s->dst_last  = last;
+		_parts        = 1;
+		_splits.clear();
+	}
+
+	// Appends every destination not in 'seen' to 'order' (and marks it), in the order in which
+	// the rows first reference them.
+	void first_touch(std::vector<Int32>& order, std::vector<bool>& seen) const {
+		SPICE_PRE(seen.size() >= static_cast<UInt>(_s->dst_last));
+
+		for (Int const src : util::range(_s->rows))
+			for (auto const edge : neighbors(src))
+				if (!seen[edge.first]) {
+					seen[edge.first] = true;
+					order.push_back(edge.first);
+				}
+	}
+
+	// Renames every destination d to index[d], keeping every row sorted (along with its edges)
+	void relabel_destinations(std::span<Int32 const> index, util::thread_pool& pool) {
+		SPICE_PRE(_s->dst_first == 0 && index.size() == static_cast<UInt>(_s->dst_last));
+		_own();
+
+		Int const rows = 1024;
+		pool.parallel_for((_s->rows + rows - 1) / rows, [&](Int const block) {
+			std::vector<Int> order;
+			std::vector<Int32> dsts;
+			[[maybe_unused]] util::optional_t<std::vector<T>, !std::is_void_v<T>> edges;
+
+			for (Int const src :
+			     util::range(block * rows, std::min((block + 1) * rows, _s->rows))) {
+				Int const first = _offset(src);
+
+				dsts.clear();
+				for (auto const edge : neighbors(src))
+					dsts.push_back(index[edge.first]);
+
+				order.resize(dsts.size());
+				std::iota(order.begin(), order.end(), 0);
+				std::sort(order.begin(), order.end(),
+				          [&](Int const a, Int const b) { return dsts[a] < dsts[b]; });
+
+				if constexpr (!std::is_void_v<T>) {
+					edges.assign(_edges.begin() + first, _edges.begin() + first + order.size());
+					for (Int const i : util::range(order))
+						_edges[first + i] = edges[order[i]];
+				}
+
+				if (_s->dense) {
+					UInt* const row = _s->bitmap.data() + src * _s->words;
+					std::fill(row, row + _s->words - 1, 0);
+					for (Int32 const dst : dsts)
+						row[dst / 64] |= 1_u64 << (dst % 64);
+				} else
+					_visit_neighbors([&](auto& neighbors) {
+						for (Int const i : util::range(order))
+							neighbors[first + i] = dsts[order[i]];
+					});
+			}
+		});
+
+		_parts = 1;
+		_splits.clear();
+	}
+
+	Int parts() const { return _parts; }
+
+	// The destinations neighbors(src, part) is restricted to (all of them for part = -1)
+	util::range_t<util::int_iterator> destinations(Int const part) const {
+		SPICE_INV(-1 <= part && part < _parts);
+
+		if (part < 0 || _parts == 1)
+			return util::range(_s->dst_first, _s->dst_last);
+
+		Int const first = _s->dst_first;
+		Int const n     = _s->dst_last - first;
+		return util::range(first + part * n / _parts, first + (part + 1) * n / _parts);
+	}
+
+	// Every worker walks every row during delivery, so rows are interleaved instead of partitioned.
+	void place(util::numa_policy policy) {
+		if (policy == util::numa_policy::partition)
+			policy = util::numa_policy::interleave;
+
+		util::numa_place(std::span(_s->offsets32), policy);
+		util::numa_place(std::span(_s->offsets64), policy);
+		util::numa_place(std::span(_s->neighbors16), policy);
+		util::numa_place(std::span(_s->neighbors32), policy);
+		util::numa_place(std::span(_s->bitmap), policy);
+		if constexpr (!std::is_void_v<T>)
+			util::numa_place(std::span(_edges), policy);
+	}
+
+	std::vector<util::numa_placement> placement() const {
+		std::vector<util::numa_placement> result{
+		    _s->narrow_offsets ? util::numa_pages("offsets", std::span(_s->offsets32)) :
+                                 util::numa_pages("offsets", std::span(_s->offsets64)),
+		    _s->dense  ? util::numa_pages("neighbors", std::span(_s->bitmap)) :
+		    _s->narrow ? util::numa_pages("neighbors", std::span(_s->neighbors16)) :
+                         util::numa_pages("neighbors", std::span(_s->neighbors32))};
+		if constexpr (!std::is_void_v<T>)
+			result.push_back(util::numa_pages("edges", std::span(_edges)));
+		return result;
+	}
+
+	// Size of the graph's structure (offsets, neighbors and splits, but not the edges' payload)
+	// as stored, and as it would be with full-width indices. Without 'structure', only counts
+	// what's never shared (the splits).
+	topology_memory memory(bool const structure = true) const {
+		Int const rows      = _s->rows > 0 && structure ? _s->rows + 1 : 0;
+		Int const edges     = _s->rows > 0 && structure ? _offset(_s->rows) : 0;
+		Int const splits    = _splits.size() * sizeof(Int32);
+		Int const offset    = _s->narrow_offsets ? sizeof(UInt32) : sizeof(Int);
+		Int const neighbors = !structure ? 0 :
+		                      _s->dense  ? _s->bitmap.size() * sizeof(UInt) :
+		                      _s->narrow ? edges * sizeof(UInt16) :
+                                           edges * sizeof(Int32);
+		return {rows * offset + neighbors + splits,
+		        rows * Int(sizeof(Int)) + edges * Int(sizeof(Int32)) + splits};
+	}
+
+	util::range_t<iterator> neighbors(Int const src, Int const part) {
+		SPICE_INV(0 <= src && src < _s->rows);
+		SPICE_INV(0 <= part && part < _parts);
+
+		if (_parts == 1)
+			return neighbors(src);
+
+		Int32 const* const split = _splits.data() + src * (_parts + 1);
+		Int const offset         = _offset(src);
+		auto const dsts          = destinations(part);
+		return _neighbors_range(src, offset + split[part], offset + split[part + 1], *dsts.begin(),
+		                        *dsts.end());
+	}
+
+	util::range_t<const_iterator> neighbors(Int const src, Int const part) const {
+		auto const r = const_cast<csr*>(this)->neighbors(src, part);
+		return {r.begin(), r.end()};
 	}
 
 private:
-	std::vector<Int> _offsets;
-	std::vector<Int32> _neighbors;
+	std::shared_ptr<csr_structure> _s;
 	[[no_unique_address]] util::optional_t<std::vector<T>, !std::is_void_v<T>> _edges;
+	Int _parts = 1;
+	std::vector<Int32> _splits;
+
+	Int _offset(Int const i) const {
+		return _s->narrow_offsets ? _s->offsets32[i] : _s->offsets64[i];
+	}
+	void _set_offset(Int const i, Int const offset) {
+		if (_s->narrow_offsets)
+			_s->offsets32[i] = offset;
+		else
+			_s->offsets64[i] = offset;
+	}
+
+	// Makes the structure exclusive to this graph before modifying it
+	void _own() {
+		if (_s.use_count() > 1)
+			_s = std::make_shared<csr_structure>(*_s);
+	}
+
+	// Generates the rows of 'c' (all of them, or only the slice [dst_first, dst_last)) into
+	// 'offsets' and 'neighbors' and sorts them. Dense graphs are turned into bitsets (leaving
+	// 'neighbors' empty), all others trim 'neighbors' to their edges.
+	void _generate(Topology& c, bool const all, util::seed_seq const& seed,
+	               util::thread_pool& pool, double const dense_density, std::vector<Int>& offsets,
+	               auto& neighbors) {
+		if (all) {
+			neighbors.resize(c.size());
+			c.generate(offsets, neighbors, seed, pool);
+		} else
+			c.generate_slice(_s->dst_first, _s->dst_last, offsets, neighbors, seed, pool);
+		SPICE_INV(std::is_sorted(offsets.begin(), offsets.end()));
+
+		Int const edges = offsets.empty() ? 0 : offsets.back();
+		std::atomic<bool> dense =
+		    all && edges > 0 && edges >= dense_density * c.src_count * double(c.dst_count);
+
+		Int const rows = 1024;
+		pool.parallel_for((c.src_count + rows - 1) / rows, [&](Int const block) {
+			for (Int const src :
+			     util::range(block * rows, std::min((block + 1) * rows, c.src_count))) {
+				auto const first = neighbors.begin() + offsets[src];
+				auto const last  = neighbors.begin() + offsets[src + 1];
+				if (!std::is_sorted(first, last))
+					std::sort(first, last);
+				// Bitsets can't hold duplicate edges
+				if (dense && std::adjacent_find(first, last) != last)
+					dense = false;
+			}
+		});
+
+		_s->dense = dense;
+		if (_s->dense) {
+			_s->words = (c.dst_count + 63) / 64 + 1;
+			_s->bitmap.resize(c.src_count * _s->words);
+			pool.parallel_for((c.src_count + rows - 1) / rows, [&](Int const block) {
+				for (Int const src :
+				     util::range(block * rows, std::min((block + 1) * rows, c.src_count))) {
+					UInt* const row = _s->bitmap.data() + src * _s->words;
+					for (Int const i : util::range(offsets[src], offsets[src + 1]))
+						row[neighbors[i] / 64] |= 1_u64 << (neighbors[i] % 64);
+					row[_s->words - 1] = 1;
+				}
+			});
+			neighbors = {};
+		} else {
+			neighbors.resize(edges);
+			neighbors.shrink_to_fit();
+		}
+	}
+
+	// Invokes f with the neighbor vector in use (lists only)
+	void _visit_neighbors(auto&& f) {
+		SPICE_INV(!_s->dense);
+		if (_s->narrow)
+			f(_s->neighbors16);
+		else
+			f(_s->neighbors32);
+	}
+
+	// Index of the first edge of row 'src' whose neighbor is >= dst
+	Int _lower_bound(Int const src, Int const dst) {
+		Int const first = _offset(src);
+		if (_s->dense) {
+			UInt const* const row = _s->bitmap.data() + src * _s->words;
+			Int count             = 0;
+			for (Int const w : util::range(dst / 64))
+				count += std::popcount(row[w]);
+			return first + count + std::popcount(row[dst / 64] & _bits(0, dst % 64));
+		}
+
+		Int result = first;
+		_visit_neighbors([&](auto& neighbors) {
+			auto const begin = neighbors.begin();
+			result = std::lower_bound(begin + first, begin + _offset(src + 1), dst) - begin;
+		});
+		return result;
+	}
+
+	// Bits [lo, hi) of a word (lo and hi may lie outside [0, 64])
+	static UInt _bits(Int const lo, Int const hi) {
+		auto const below = [](Int const i) {
+			return i <= 0 ? 0 : i >= 64 ? ~0_u64 : (1_u64 << i) - 1;
+		};
+		return below(hi) & ~below(lo);
+	}
+
+	// Edges [first, last) of row 'src', whose neighbors lie in [lo, hi)
+	util::range_t<iterator> _neighbors_range(Int const src, Int const first, Int const last,
+	                                         Int const lo, Int const hi) {
+		auto const edge = [&](Int const i) -> T* {
+			if constexpr (std::is_void_v<T>)
+				return nullptr;
+			else
+				return _edges.data() + i;
+		};
+
+		if (_s->dense) {
+			UInt const* const row = _s->bitmap.data() + src * _s->words;
+			return {{row + lo / 64, Int32(lo), edge(first)},
+			        {row + hi / 64, Int32(hi), edge(last)}};
+		}
+
+		void const* const neighbors =
+		    _s->narrow ? static_cast<void const*>(_s->neighbors16.data()) : _s->neighbors32.data();
+		Int32 const width = _s->narrow ? sizeof(UInt16) : sizeof(Int32);
+		auto const at     = [&](Int const i) {
+			    return static_cast<void const*>(static_cast<char const*>(neighbors) + i * width);
+		};
+		return {{at(first), width, edge(first)}, {at(last), width, edge(last)}};
+	}
 };
 }
\ No newline at end of file
@@ -1,35 +1,119 @@
 #pragma once
 
 #include <algorithm>
-#include <numeric>
+#include <array>
+#include <bit>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "spice/concepts.h"
 #include "spice/util/assert.h"
+#include "spice/util/checkpoint.h"
 #include "spice/util/meta.h"
+#include "spice/util/numa.h"
 #include "spice/util/random.h"
 #include "spice/util/range.h"
+#include "spice/util/simd.h"
+#include "spice/util/soa.h"
 #include "spice/util/stdint.h"
+#include "spice/util/thread_pool.h"
 #include "spice/util/type_traits.h"
 
 namespace spice::detail {
+// spikes(age) returns the spikes emitted 'age' < max_delay() steps ago, spikes_at(step) those
+// emitted during the given step (counting from 0 = the first update). history() holds one
+// bitmask per neuron covering the last 64 steps, see history_at().
 struct NeuronPopulation {
-	virtual ~NeuronPopulation()                                               = default;
-	virtual Int size() const                                                  = 0;
-	virtual void update(Int max_delay, float dt, util::xoroshiro64_128p& rng) = 0;
-	virtual void* neurons()                                                   = 0;
-	virtual std::span<Int32 const> spikes(Int age) const                      = 0;
-	virtual void plastic()                                                    = 0;
-	virtual std::span<UInt const> history() const                             = 0;
+	virtual ~NeuronPopulation()                                                        = default;
+	virtual Int size() const                                                           = 0;
+	virtual void update(float dt, util::seed_seq const& seed, util::thread_pool& pool) = 0;
+	virtual void* neurons()                                                            = 0;
+	virtual std::span<Int32 const> spikes(Int age) const                               = 0;
+	virtual Int max_delay() const                                                      = 0;
+	virtual std::span<Int32 const> spikes_at(Int step) const                           = 0;
+	virtual void plastic()                                                             = 0;
+	virtual std::span<UInt const> history() const                                      = 0;
+	virtual void place(util::numa_policy policy)                                       = 0;
+	virtual std::vector<util::numa_placement> placement() const                        = 0;
+	virtual bool own(Int first, Int last)                                              = 0;
+	virtual void set_spikes(Int step, std::span<Int32 const> spikes)                   = 0;
+	virtual bool reorder(std::span<Int32 const> order)                                 = 0;
+	virtual void save(util::checkpoint_writer& out) const                              = 0;
+	virtual void load(util::checkpoint_reader& in)                                     = 0;
 };
 
-// The following adapters provide a unified interface (size(), update()) to a variety of neuron types
+// Populations are updated in blocks of this many neurons. Every block collects its own spikes
+// and every neuron draws from its own counter-based random stream (keyed by the step's and
+// population's seed and the neuron's index), so blocks can be updated in any order and on any
+// thread while producing identical results.
+constexpr Int block_size = 1024;
+constexpr Int block_count(Int const size) { return (size + block_size - 1) / block_size; }
+constexpr auto block_range(Int const block, Int const size) {
+	return util::range(block * block_size, std::min((block + 1) * block_size, size));
+}
+
+// How the state of a stateful neuron population is stored (type), and how synapses access it
+// given NeuronPopulation::neurons() (view()): as an array of structs by default, as a structure
+// of arrays for SoANeuron types. Either way, elements are accessed via util::apply_at().
+template <StatefulNeuron Neur>
+struct neuron_storage {
+	using type = std::vector<typename Neur::neuron>;
+
+	static std::span<typename Neur::neuron> view(void* neurons, Int const size) {
+		return {static_cast<typename Neur::neuron*>(neurons), static_cast<UInt>(size)};
+	}
+	static std::span<typename Neur::neuron const> view(void const* neurons, Int const size) {
+		return {static_cast<typename Neur::neuron const*>(neurons), static_cast<UInt>(size)};
+	}
+};
+
+template <SoANeuron Neur>
+struct neuron_storage<Neur> {
+	using type = util::soa_vector<typename Neur::neuron>;
+
+	static type& view(void* neurons, Int const size) {
+		SPICE_INV(static_cast<type*>(neurons)->size() == size);
+		return *static_cast<type*>(neurons);
+	}
+	static type const& view(void const* neurons, Int const size) {
+		SPICE_INV(static_cast<type const*>(neurons)->size() == size);
+		return *static_cast<type const*>(neurons);
+	}
+};
+
+// Bit 63 - step % 64 of a neuron's history records whether it spiked during 'step'. Fixed
+// positions (rather than shifting every neuron's history once per step) mean that updates only
+// touch the neurons that spiked. history_at() turns such a bitmask into one relative to 'step',
+// the last update: bit k is set iff the neuron spiked k steps before it.
+inline UInt history_at(UInt const history, Int const step) {
+	return std::rotl(history, static_cast<int>((step + 1) % 64));
+}
+
+// The instance of Neur shared by all neurons is part of checkpoints if it can be copied as is
+// (otherwise it's left as passed to snn::add_population())
+template <class Neur>
+void save_neuron(util::checkpoint_writer& out, Neur const& neuron) {
+	if constexpr (std::is_trivially_copyable_v<Neur>)
+		out.write_value(neuron);
+}
+template <class Neur>
+void load_neuron(util::checkpoint_reader& in, Neur& neuron) {
+	if constexpr (std::is_trivially_copyable_v<Neur>)
+		in.read_value(neuron);
+}
+
+// The following adapters provide a unified interface (size(), update(), save(), load()) to a
+// variety of neuron types. Their constructors skip initializing the neurons' state unless
+// 'init' (e.g. when it's about to be loaded from a checkpoint instead).
 
 template <Neuron Neur>
 class stateless_neuron_adapter {
 public:
-	stateless_neuron_adapter(Neur neuron, Int const size, util::seed_seq&) :
+	stateless_neuron_adapter(Neur neuron, Int const size, util::seed_seq&, bool) :
 	_neuron(std::move(neuron)), _size(size) {
 		SPICE_INV(StatelessNeuron<Neur>);
 		SPICE_INV(size >= 0);
@@ -37,13 +121,36 @@ public:
 
 	Int size() const { return _size; }
 
-	void update(float const dt, auto& rng, std::vector<Int32>& out_spikes) {
-		for (Int const i : util::range(size())) {
-			if (_neuron.update(dt, rng))
-				out_spikes.push_back(i);
+	// Updates neurons [first, last)
+	void update(Int const first, Int const last, float const dt, util::seed_seq const& seed,
+	            std::vector<Int32>& out_spikes) {
+		if constexpr (PerRangeUpdate<Neur>) {
+			// Always samples the whole block and drops the spikes of neurons outside
+			// [first, last), so the result doesn't depend on which neurons are owned.
+			Int const block  = first / block_size;
+			auto const range = block_range(block, _size);
+			SPICE_INV(*range.begin() <= first && last <= *range.end());
+
+			util::xoroshiro64_128p rng(seed.stream(block));
+			Int const count = out_spikes.size();
+			_neuron.update(*range.begin(), *range.end(), dt, rng, out_spikes);
+			out_spikes.erase(std::remove_if(out_spikes.begin() + count, out_spikes.end(),
+			                                [&](Int32 const i) { return i < first || i >= last; }),
+			                 out_spikes.end());
+		} else {
+			for (Int const i : util::range(first, last)) {
+				util::philox4x32_10 rng(seed, i);
+				if (_neuron.update(dt, rng))
+					out_spikes.push_back(i);
+			}
 		}
 	}
 
+	Neur& neuron() { return _neuron; }
+
+	void save(util::checkpoint_writer& out) const { save_neuron(out, _neuron); }
+	void load(util::checkpoint_reader& in) { load_neuron(in, _neuron); }
+
 private:
 	Neur _neuron;
 	Int _size;
@@ -52,41 +159,166 @@ private:
 template <Neuron Neur>
 class stateful_neuron_adapter {
 public:
-	stateful_neuron_adapter(Neur neuron, Int const size, util::seed_seq& seed) :
+	stateful_neuron_adapter(Neur neuron, Int const size, util::seed_seq& seed, bool const init) :
 	_neuron(std::move(neuron)), _neurons(size) {
 		SPICE_INV(StatefulNeuron<Neur>);
 		SPICE_INV(size >= 0);
 
+		// Consumes the seed either way, so later populations draw the same numbers
 		util::xoroshiro64_128p rng(seed++);
+		if (!init)
+			return;
 
 		if constexpr (PerNeuronInit<Neur>) {
-			Int id = 0;
-			for (auto& n : _neurons)
-				neuron.init(n, id++, rng);
-		} else if constexpr (PerPopulationInit<Neur>)
-			neuron.init(std::span<typename Neur::neuron>(_neurons), rng);
+			for (Int const id : util::range(size))
+				util::apply_at(neurons(), id, [&](auto& n) { neuron.init(n, id, rng); });
+		} else if constexpr (PerPopulationInit<Neur>) {
+			if constexpr (SoANeuron<Neur>) {
+				std::vector<typename Neur::neuron> tmp(size);
+				neuron.init(std::span<typename Neur::neuron>(tmp), rng);
+				for (Int const i : util::range(size))
+					_neurons.store(i, tmp[i]);
+			} else
+				neuron.init(std::span<typename Neur::neuron>(_neurons), rng);
+		}
 	}
 
 	Int size() const { return _neurons.size(); }
 
-	void update(float const dt, auto& rng, std::vector<Int32>& out_spikes) {
+	// Updates neurons [first, last)
+	void update(Int const first, Int const last, float const dt, util::seed_seq const& seed,
+	            std::vector<Int32>& out_spikes) {
+		if constexpr (PerBatchUpdate<Neur>) {
+			Int const count = out_spikes.size();
+			out_spikes.resize(count + (last - first) + util::simd_width);
+			Int32* out = out_spikes.data() + count;
+
+			for (Int i = first; i < last; i += util::simd_width) {
+				Int const n = std::min(util::simd_width, last - i);
+				// One stream per lane, just like per-neuron updates (lanes >= n are padding)
+				auto rng = [&]<Int... L>(std::integer_sequence<Int, L...>) {
+					return std::array{util::philox4x32_10(seed, L < n ? _id(i + L) : 0)...};
+				}(std::make_integer_sequence<Int, util::simd_width>{});
+
+				auto batch = _neurons.template load_batch<typename Neur::batch>(i, n);
+				UInt32 const mask = _neuron.update(batch, dt, rng);
+				_neurons.store_batch(i, n, batch);
+
+				out += util::compress(mask & ((1u << n) - 1), Int32(i), out);
+			}
+			out_spikes.resize(out - out_spikes.data());
+			if (!_ids.empty())
+				for (Int const j : util::range(count, out_spikes.size()))
+					out_spikes[j] = _ids[out_spikes[j]];
+		} else if constexpr (SoANeuron<Neur>) {
+			// Collecting spikes in a separate pass keeps the update loop free of
+			// data-dependent control flow, so it can be vectorized.
+			constexpr Int chunk = 256;
+			bool spiked[chunk];
+			for (Int i = first; i < last; i += chunk) {
+				Int const n = std::min(chunk, last - i);
+				if (n == chunk)
+					_update_chunk<chunk>(i, chunk, dt, seed, spiked);
+				else
+					_update_chunk<0>(i, n, dt, seed, spiked);
+				for (Int j = 0; j < n; j++)
+					if (spiked[j])
+						out_spikes.push_back(_id(i + j));
+			}
+		} else {
+			for (Int const i : util::range(first, last)) {
+				util::philox4x32_10 rng(seed, _id(i));
+				if (_neuron.update(_neurons[i], dt, rng))
+					out_spikes.push_back(_id(i));
+			}
+		}
+	}
+
+	Neur& neuron() { return _neuron; }
+
+	// Moves the neuron at position order[i] to position i. Neurons keep drawing from (and
+	// spiking under) their original ids, so only the layout changes.
+	void reorder(std::span<Int32 const> order) {
+		SPICE_PRE(order.size() == static_cast<UInt>(size()));
+
+		typename neuron_storage<Neur>::type neurons(size());
+		std::vector<Int32> ids(size());
 		for (Int const i : util::range(size())) {
-			if (_neuron.update(_neurons[i], dt, rng))
-				out_spikes.push_back(i);
+			if constexpr (SoANeuron<Neur>)
+				neurons.store(i, _neurons.load(order[i]));
+			else
+				neurons[i] = _neurons[order[i]];
+			ids[i] = _id(order[i]);
 		}
+		_neurons = std::move(neurons);
+		_ids     = std::move(ids);
 	}
 
-	std::span<typename Neur::neuron> neurons() { return _neurons; }
+	// Unlike the instance of Neur, per-neuron state is required: Populations whose state can't
+	// be copied as is throw std::runtime_error.
+	void save(util::checkpoint_writer& out) const {
+		save_neuron(out, _neuron);
+		if constexpr (SoANeuron<Neur>)
+			_neurons.for_each_field([&](char const*, auto field) { out.write(field); });
+		else if constexpr (std::is_trivially_copyable_v<typename Neur::neuron>)
+			out.write(_neurons);
+		else
+			throw std::runtime_error("neuron_population: neurons aren't trivially copyable");
+		out.write(_ids);
+	}
+	void load(util::checkpoint_reader& in) {
+		load_neuron(in, _neuron);
+		if constexpr (SoANeuron<Neur>)
+			_neurons.for_each_field([&](char const*, auto field) { in.read(field); });
+		else if constexpr (std::is_trivially_copyable_v<typename Neur::neuron>)
+			in.read(std::span(_neurons));
+		else
+			throw std::runtime_error("neuron_population: neurons aren't trivially copyable");
+		in.read(_ids);
+	}
+
+	// std::span for arrays of structs, util::soa_vector& for structures of arrays
+	decltype(auto) neurons() {
+		if constexpr (SoANeuron<Neur>)
+			return (_neurons);
+		else
+			return std::span(_neurons);
+	}
+	decltype(auto) neurons() const {
+		if constexpr (SoANeuron<Neur>)
+			return (_neurons);
+		else
+			return std::span(_neurons);
+	}
 
 private:
 	Neur _neuron;
-	std::vector<typename Neur::neuron> _neurons;
+	typename neuron_storage<Neur>::type _neurons;
+	// The id of the neuron stored at every position, empty while in id order (see reorder())
+	std::vector<Int32> _ids;
+
+	Int32 _id(Int const i) const { return _ids.empty() ? Int32(i) : _ids[i]; }
+
+	// Updates the neurons [i, i + n) of a structure of arrays, n = N if N > 0. At -O2, GCC only
+	// vectorizes loops that need neither a scalar epilogue nor runtime alias checks, and only
+	// once everything has been inlined. Hence the constant trip count of full chunks, ivdep
+	// (neurons are independent), and flatten.
+	template <Int N>
+	[[gnu::flatten]] void _update_chunk(Int const i, Int const n, float const dt,
+	                                    util::seed_seq const& seed, bool* const spiked) {
+#pragma GCC ivdep
+		for (Int j = 0; j < (N > 0 ? N : n); j++) {
+			util::philox4x32_10 rng(seed, _id(i + j));
+			util::apply_at(_neurons, i + j,
+			               [&](auto& neuron) { spiked[j] = _neuron.update(neuron, dt, rng); });
+		}
+	}
 };
 
 template <Neuron Neur>
 class per_pop_update_adapter : public Neur {
 public:
-	per_pop_update_adapter(Neur neuron, Int const size, util::seed_seq&) :
+	per_pop_update_adapter(Neur neuron, Int const size, util::seed_seq&, bool) :
 	Neur(std::move(neuron)), _size(size) {
 		SPICE_INV(PerPopulationUpdate<Neur>);
 		SPICE_INV(size >= 0);
@@ -96,6 +328,11 @@ public:
 
 	// using Neur::update()
 
+	Neur& neuron() { return *this; }
+
+	void save(util::checkpoint_writer& out) const { save_neuron<Neur>(out, *this); }
+	void load(util::checkpoint_reader& in) { load_neuron<Neur>(in, *this); }
+
 private:
 	Int _size;
 };
@@ -103,70 +340,237 @@ private:
 template <Neuron Neur>
 class neuron_population : public NeuronPopulation {
 public:
-	neuron_population(Neur neuron, Int const size, util::seed_seq& seed, Int const max_delay) :
-	_neuron(std::move(neuron), size, seed) {
+	// With a 'checkpoint', the population's state is read from its next sections (see save())
+	// rather than initialized.
+	neuron_population(Neur neuron, Int const size, util::seed_seq& seed, Int const max_delay,
+	                  util::checkpoint_reader* const checkpoint = nullptr) :
+	_neuron(std::move(neuron), size, seed, !checkpoint), _max_delay(max_delay), _last(size) {
 		SPICE_INV(max_delay >= 1);
 
-		_spike_counts.reserve(max_delay);
-		_spikes.reserve(size * max_delay / 100);
+		// Spikes are kept in a ring of per-step slots. Twice the maximum delay, because during a
+		// multi-step run (see snn::run()) a population may get up to min_delay <= max_delay
+		// steps ahead of the connections reading its spikes. Retiring a step merely clears its
+		// slot (keeping the slot's capacity), and every slot grows on its own, so neither moves
+		// the spikes of other steps.
+		_spikes.resize(2 * max_delay);
+		_slot_steps.resize(2 * max_delay, -1);
+
+		if (checkpoint)
+			load(*checkpoint);
 	}
 
 	Int size() const override { return _neuron.size(); }
 
-	void update(Int const max_delay, float const dt, util::xoroshiro64_128p& rng) override {
-		SPICE_INV(max_delay >= 1);
-
-		if (_spike_counts.size() == max_delay) {
-			_spikes.erase(_spikes.begin(), _spikes.begin() + _spike_counts.front());
-			_spike_counts.erase(_spike_counts.begin());
+	void update(float const dt, util::seed_seq const& seed, util::thread_pool& pool) override {
+		Int const slot = _steps % _spikes.size();
+		auto& spikes   = _spikes[slot];
+		spikes.clear();
+		_slot_steps[slot] = _steps;
+
+		if constexpr (PerPopulationUpdate<Neur>) {
+			util::xoroshiro64_128p rng(seed);
+			_neuron.update(dt, rng, spikes);
+		} else {
+			_block_spikes.resize(_blocks());
+			pool.parallel_for(_block_spikes.size(), [&](Int const i) {
+				auto const block = _owned_block(i);
+				_block_spikes[i].clear();
+				_neuron.update(*block.begin(), *block.end(), dt, seed, _block_spikes[i]);
+			});
+
+			for (auto const& block : _block_spikes)
+				spikes.insert(spikes.end(), block.begin(), block.end());
+			// Blocks are stored in reordered layout, but spikes are reported in id order
+			if (!_index.empty())
+				std::sort(spikes.begin(), spikes.end());
 		}
 
-		Int const spike_count = _spikes.size();
-		_neuron.update(dt, rng, _spikes);
 		if (_plastic) {
-			for (auto& hist : _history)
-				hist <<= 1;
-
-			for (auto spike : util::range(_spikes.begin() + spike_count, _spikes.end()))
-				_history[spike] |= 1;
+			// This step's bit last recorded the spikes of 64 steps ago
+			auto& expired  = _history_log[_steps % 64];
+			UInt const bit = 1_u64 << (63 - _steps % 64);
+			for (auto spike : expired)
+				_history[index(spike)] &= ~bit;
+			for (auto spike : spikes)
+				_history[index(spike)] |= bit;
+			expired.assign(spikes.begin(), spikes.end());
 		}
-		_spike_counts.push_back(_spikes.size() - spike_count);
+		_steps++;
 	}
 
 	void* neurons() override {
-		if constexpr (StatefulNeuron<Neur>)
+		if constexpr (SoANeuron<Neur>)
+			return &get_neurons();
+		else if constexpr (StatefulNeuron<Neur>)
 			return get_neurons().data();
 		else
 			return nullptr;
 	}
-	auto get_neurons() {
+	decltype(auto) get_neurons() {
 		static_assert(StatefulNeuron<Neur>, "Can only return collections of stateful neurons.");
 		return _neuron.neurons();
 	}
+	// The instance of Neur shared by all neurons, e.g. to change parameters in between
+	// steps (see spice::poisson_source)
+	Neur& get_neuron() { return _neuron.neuron(); }
 
 	std::span<Int32 const> spikes(Int age) const override {
-		SPICE_PRE(0 <= age && age < _spike_counts.size());
+		SPICE_PRE(0 <= age && age < std::min(_steps, _max_delay));
+		return spikes_at(_steps - 1 - age);
+	}
+	Int max_delay() const override { return _max_delay; }
+
+	// Does not inspect the population's progress, so it may be called while the population is
+	// being updated, as long as 'step' lies within the last max_delay steps.
+	std::span<Int32 const> spikes_at(Int step) const override {
+		SPICE_PRE(step >= 0);
+		Int const slot = step % _spikes.size();
+		SPICE_PRE(_slot_steps[slot] == step && "step has already been retired");
+		return _spikes[slot];
+	}
+
+	// Distributed simulation (see snn::distribute()): Only neurons [first, last) are updated,
+	// the spikes of all other neurons are provided via set_spikes(). Populations which can only
+	// be updated as a whole (PerPopulationUpdate) are replicated instead: own() returns false and
+	// all neurons keep being updated.
+	bool own(Int const first, Int const last) override {
+		SPICE_PRE(0 <= first && first <= last && last <= size());
+
+		if constexpr (PerPopulationUpdate<Neur>)
+			return false;
+
+		_first = first;
+		_last  = last;
+		return true;
+	}
 
-		Int const offset = std::accumulate(_spike_counts.end() - 1 - age, _spike_counts.end(), 0);
-		return {_spikes.data() + _spikes.size() - offset,
-		        static_cast<UInt>(_spike_counts.rbegin()[age])};
+	// Replaces the spikes emitted during 'step' (which must lie within the last max_delay steps)
+	void set_spikes(Int const step, std::span<Int32 const> spikes) override {
+		SPICE_PRE(0 <= step && step < _steps);
+		_spikes[step % _spikes.size()].assign(spikes.begin(), spikes.end());
 	}
 
+	// Changes the storage layout (see stateful_neuron_adapter::reorder()): The neuron at position
+	// order[i] moves to position i. Spikes keep referring to neurons by id, while get_neurons() and
+	// history() follow the new layout, index() maps from one to the other. Returns false (and
+	// does nothing) for populations without state, which have nothing to lay out.
+	bool reorder(std::span<Int32 const> order) override {
+		SPICE_PRE(order.size() == static_cast<UInt>(size()));
+
+		if constexpr (!StatefulNeuron<Neur> || PerPopulationUpdate<Neur>)
+			return false;
+		else {
+			std::vector<Int32> ids(size());
+			for (Int const i : util::range(size()))
+				ids[index(i)] = i;
+
+			std::vector<UInt> history(_history.size());
+			for (Int const i : util::range(_history.size()))
+				history[i] = _history[order[i]];
+			_history = std::move(history);
+
+			_neuron.reorder(order);
+			_index.resize(size());
+			for (Int const i : util::range(size()))
+				_index[ids[order[i]]] = i;
+
+			if (_numa != util::numa_policy::local)
+				place(_numa);
+			return true;
+		}
+	}
+
+	// Everything but the (per-run) NUMA policy and ownership, see snn::save()
+	void save(util::checkpoint_writer& out) const override {
+		out.write_value(std::array<Int, 4>{size(), _max_delay, _steps, _plastic});
+		_neuron.save(out);
+		out.write(_spikes);
+		out.write(_slot_steps);
+		out.write(_history);
+		out.write(_index);
+		out.write(_history_log);
+	}
+	void load(util::checkpoint_reader& in) override {
+		auto const header = in.read_value<std::array<Int, 4>>();
+		if (header[0] != size() || header[1] != _max_delay)
+			throw std::runtime_error("neuron_population: checkpoint of a different population");
+		_steps   = header[2];
+		_plastic = header[3];
+		_neuron.load(in);
+		in.read(_spikes);
+		in.read(_slot_steps);
+		in.read(_history);
+		in.read(_index);
+		in.read(_history_log);
+
+		if (_numa != util::numa_policy::local)
+			place(_numa);
+	}
+
+	// Position of neuron 'id' in get_neurons() and history()
+	Int index(Int const id) const { return _index.empty() ? id : _index[id]; }
+
 	void plastic() {
 		_history.resize(size());
+		_history_log.resize(64);
 		_plastic = true;
+
+		if (_numa != util::numa_policy::local)
+			util::numa_place(std::span(_history), _numa);
 	}
 
 	std::span<UInt const> history() const override { return _history; }
 
+	// Spike buffers are small and refilled every step, so they're left to first touch.
+	void place(util::numa_policy const policy) override {
+		_numa = policy;
+		if constexpr (SoANeuron<Neur>)
+			_neuron.neurons().for_each_field(
+			    [&](char const*, auto field) { util::numa_place(field, policy); });
+		else if constexpr (StatefulNeuron<Neur>)
+			util::numa_place(_neuron.neurons(), policy);
+		util::numa_place(std::span(_history), policy);
+	}
+
+	std::vector<util::numa_placement> placement() const override {
+		std::vector<util::numa_placement> result;
+		if constexpr (SoANeuron<Neur>)
+			_neuron.neurons().for_each_field([&](char const* name, auto field) {
+				result.push_back(util::numa_pages("neurons." + std::string(name), field));
+			});
+		else if constexpr (StatefulNeuron<Neur>)
+			result.push_back(util::numa_pages("neurons", _neuron.neurons()));
+		result.push_back(util::numa_pages("history", std::span(_history)));
+		return result;
+	}
+
 private:
 	std::conditional_t<PerPopulationUpdate<Neur>, per_pop_update_adapter<Neur>,
 	                   std::conditional_t<StatefulNeuron<Neur>, stateful_neuron_adapter<Neur>,
 	                                      stateless_neuron_adapter<Neur>>>
 	    _neuron;
-	std::vector<Int32> _spikes;
-	std::vector<Int32> _spike_counts;
+	Int _max_delay;
+	Int _steps = 0;
+	std::vector<std::vector<Int32>> _spikes;
+	// The step whose spikes each slot of _spikes currently holds (-1 if none)
+	std::vector<Int> _slot_steps;
+	std::vector<std::vector<Int32>> _block_spikes;
 	std::vector<UInt> _history;
-	bool _plastic = false;
+	// The position of every neuron, empty while in id order (see reorder())
+	std::vector<Int32> _index;
+	// The spikes of the last 64 steps, whose bits have to be cleared once they're reused
+	std::vector<std::vector<Int32>> _history_log;
+	bool _plastic           = false;
+	util::numa_policy _numa = util::numa_policy::local;
+	Int _first              = 0;
+	Int _last;
+
+	// The owned neurons, in blocks aligned to multiples of block_size
+	Int _blocks() const { return _first == _last ? 0 : block_count(_last) - _first / block_size; }
+	auto _owned_block(Int const i) const {
+		Int const block = _first / block_size + i;
+		return util::range(std::max(block * block_size, _first),
+		                   std::min((block + 1) * block_size, _last));
+	}
 };
 }
\ No newline at end of file
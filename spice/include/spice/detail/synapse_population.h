@@ -1,90 +1,327 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
 #include <span>
 #include <type_traits>
+#include <vector>
 
 #include "spice/concepts.h"
 #include "spice/detail/csr.h"
+#include "spice/detail/neuron_population.h"
 #include "spice/topology.h"
 #include "spice/util/assert.h"
+#include "spice/util/checkpoint.h"
 #include "spice/util/meta.h"
+#include "spice/util/numa.h"
 #include "spice/util/random.h"
 #include "spice/util/range.h"
 #include "spice/util/stdint.h"
+#include "spice/util/thread_pool.h"
 #include "spice/util/type_traits.h"
 
+namespace spice {
+// How a connection delivers spikes. 'scatter' applies the edges of one spike after another,
+// writing all over the destination population. 'bucketed' first collects the neighbor lists of
+// all spikes, then walks them in lock-step, one bucket of consecutive destination neurons at a
+// time (rows are sorted by destination), so that every bucket's neurons stay cache-resident.
+// This pays off once the destination population's state no longer fits into the L2 cache and
+// receives several spikes per step. 'procedural' stores no edges at all, but regenerates the rows
+// of all spiking sources during delivery (see Topology::procedural()), trading random number
+// generation for memory. It's limited to stateless synapses and procedural topologies such as
+// fixed_probability. All modes produce identical results.
+enum class delivery { scatter, bucketed, procedural };
+}
+
 namespace spice::detail {
 struct SynapsePopulation {
-	virtual ~SynapsePopulation()                            = default;
+	virtual ~SynapsePopulation()                                                       = default;
 	virtual void deliver(Int time, float dt, std::span<Int32 const> spikes, void const* src_neurons,
 	                     Int src_size, void* dst_neurons, Int dst_size,
-	                     std::span<UInt const> dst_history) = 0;
-	virtual void update(Int time, float dt, Int src_size, std::span<UInt const> dst_history) = 0;
-	virtual Int delay() const                                                                = 0;
+	                     std::span<UInt const> dst_history, util::thread_pool& pool)   = 0;
+	virtual void update(Int time, float dt, Int src_first, Int src_last,
+	                    std::span<UInt const> dst_history, util::thread_pool& pool)    = 0;
+	virtual Int delay() const                                                          = 0;
+	virtual void place(util::numa_policy policy)                                       = 0;
+	virtual std::vector<util::numa_placement> placement() const                        = 0;
+	virtual topology_memory memory(bool structure) const                               = 0;
+	virtual std::shared_ptr<csr_structure> const& structure() const                    = 0;
+	virtual void first_touch(std::vector<Int32>& order, std::vector<bool>& seen) const = 0;
+	virtual void relabel(std::span<Int32 const> index, util::thread_pool& pool)        = 0;
+	virtual void save(util::checkpoint_writer& out) const                              = 0;
+	virtual void load(util::checkpoint_reader& in)                                     = 0;
 };
 
 template <class Syn, Neuron SrcNeur, StatefulNeuron DstNeur>
 requires Synapse<Syn, SrcNeur, DstNeur>
 class synapse_population : public SynapsePopulation {
 public:
-	synapse_population(Syn syn, Topology& c, util::seed_seq& seed, Int const delay) :
-	_syn(std::move(syn)), _graph(c, seed++), _delay(delay) {
+	// Buckets of this many neurons take up half of a (typical, 256KB) L2 cache
+	static constexpr Int default_bucket_size =
+	    std::max<Int>(1, 128 * 1024 / sizeof(typename DstNeur::neuron));
+
+	// bucket_size > 0 selects bucketed delivery (see spice::delivery) with buckets of that many
+	// destination neurons, 'procedural' selects procedural delivery. A non-null 'structure'
+	// (taken from a connection with identical rows, see Topology::fingerprint()) is shared
+	// instead of generating the rows of 'c'. With a 'checkpoint', the synapses' state is read
+	// from its next sections (see save()) rather than initialized. Only the synapses targeting
+	// [dst_first, dst_last) are ever generated and initialized (all of them if dst_last < 0), see
+	// snn::distribute().
+	synapse_population(Syn syn, Topology& c, util::seed_seq& seed, Int const delay,
+	                   util::thread_pool& pool, Int const bucket_size = 0,
+	                   bool const procedural = false,
+	                   std::shared_ptr<csr_structure> structure = nullptr,
+	                   util::checkpoint_reader* const checkpoint = nullptr,
+	                   Int const dst_first = 0, Int const dst_last = -1) :
+	_syn(std::move(syn)),
+	_graph(procedural ? graph_t(c.dst_count) :
+	       structure  ? graph_t(std::move(structure)) :
+                        graph_t(c, dst_first, dst_last < 0 ? c.dst_count : dst_last, seed, pool)),
+	_delay(delay),
+	_bucket_size(bucket_size) {
 		SPICE_PRE(delay >= 1);
+		SPICE_PRE(bucket_size >= 0);
+		SPICE_PRE(!(procedural && StatefulSynapse<Syn>) &&
+		          "Only stateless synapses support procedural delivery.");
+		SPICE_PRE(!(procedural && bucket_size > 0));
+		SPICE_PRE(!(structure && dst_last >= 0) &&
+		          "Sliced connections can't share their structure.");
+
+		if (procedural) {
+			_procedural = c.procedural(seed);
+			SPICE_PRE(_procedural && "The topology doesn't support procedural connectivity.");
+			if (dst_last >= 0)
+				_graph.filter_destinations(dst_first, dst_last);
+		}
+		seed++;
 
 		if constexpr (PerSynapseInit<Syn>) {
-			util::xoroshiro64_128p rng(seed++);
-			for (auto src : util::range(c.src_count)) {
-				for (auto edge : _graph.neighbors(src)) {
-					_syn.init(*edge.second, src, edge.first, rng);
-				}
+			// Every synapse draws from its own stream, keyed by its source, destination and
+			// (for duplicate edges) ordinal, so that slices are initialized the same way as the
+			// whole connection. Consumes the seed either way, so later connections draw the
+			// same numbers.
+			util::seed_seq const init = seed++;
+			if (!checkpoint) {
+				Int const rows = 256;
+				pool.parallel_for((c.src_count + rows - 1) / rows, [&](Int const block) {
+					for (Int const src :
+					     util::range(block * rows, std::min((block + 1) * rows, c.src_count))) {
+						util::seed_seq const streams = init.stream(src);
+						Int32 prev                   = -1;
+						Int duplicate                = 0;
+						for (auto edge : _graph.neighbors(src)) {
+							duplicate = edge.first == prev ? duplicate + 1 : 0;
+							prev      = edge.first;
+							util::philox4x32_10 rng(
+							    duplicate > 0 ? streams.stream(duplicate) : streams, edge.first);
+							_syn.init(*edge.second, src, edge.first, rng);
+						}
+					}
+				});
 			}
 		}
 
 		if constexpr (PlasticSynapse<Syn>)
 			_ages.resize(c.src_count);
+
+		if (checkpoint)
+			load(*checkpoint);
 	}
 
+	// Delivers spikes in parallel by splitting the destination population into one block per
+	// worker. Every worker walks all spikes but only applies edges targeting its own block, so
+	// no two threads ever write to the same neuron and every neuron receives its spikes in the
+	// same order as during sequential delivery.
 	void deliver(Int const time, float const dt, std::span<Int32 const> spikes,
 	             void const* const src_neurons, Int const src_size, void* const dst_neurons,
-	             Int const dst_size, std::span<UInt const> dst_history) override {
+	             Int const dst_size, std::span<UInt const> dst_history,
+	             util::thread_pool& pool) override {
 		SPICE_INV(src_size >= 0);
 		SPICE_INV(dst_neurons);
 		SPICE_INV(dst_size >= 0);
 
-		std::span<typename DstNeur::neuron> dst_span{
-		    static_cast<typename DstNeur::neuron*>(dst_neurons), static_cast<UInt>(dst_size)};
+		decltype(auto) dst_view = neuron_storage<DstNeur>::view(dst_neurons, dst_size);
 
-		if constexpr (StatefulNeuron<SrcNeur>) {
-			SPICE_INV(src_neurons);
-			_update<true>(time, dt, spikes,
-			              std::span<typename SrcNeur::neuron const>{
-			                  static_cast<typename SrcNeur::neuron const*>(src_neurons),
-			                  static_cast<UInt>(src_size)},
-			              dst_span, dst_history);
+		// Reading from and writing to the same population concurrently would be racy.
+		bool const partitioned =
+		    pool.size() > 1 && spikes.size() > 0 &&
+		    !(DeliverFromTo<Syn, SrcNeur, DstNeur> && src_neurons == dst_neurons);
+
+		if (_bucket_size > 0)
+			_rows.resize(pool.size());
+		if (_procedural)
+			_generate(spikes, pool);
+
+		auto deliver_part = [&](Int const part) {
+			auto const deliver = [&](auto&& src_view) {
+				if (_procedural)
+					_deliver_generated(spikes, src_view, dst_view, part);
+				else
+					_update<true>(time, dt, spikes, src_view, dst_view, dst_history, part);
+			};
+			if constexpr (StatefulNeuron<SrcNeur>) {
+				SPICE_INV(src_neurons);
+				deliver(neuron_storage<SrcNeur>::view(src_neurons, src_size));
+			} else
+				deliver(util::empty_t{});
+		};
+
+		if (partitioned) {
+			_graph.partition(pool.size());
+			pool.parallel_for(_graph.parts(), deliver_part);
+
+			if constexpr (PlasticSynapse<Syn>)
+				for (auto src : spikes)
+					_ages[src] = (time + 1) | (1_u64 << 63);
 		} else
-			_update<true>(time, dt, spikes, util::empty_t{}, dst_span, dst_history);
+			deliver_part(-1);
 	}
 
-	void update(Int const time, float const dt, Int const src_size,
-	            std::span<UInt const> dst_history) override {
-		if constexpr (PlasticSynapse<Syn>)
-			_update<false>(time, dt, util::range(src_size), util::empty_t{}, {}, dst_history);
+	// Catches up on the plasticity of sources [src_first, src_last) in parallel. Must be called
+	// for every source at least once every 64 steps (the length of the spike history).
+	void update(Int const time, float const dt, Int const src_first, Int const src_last,
+	            std::span<UInt const> dst_history, util::thread_pool& pool) override {
+		SPICE_PRE(0 <= src_first && src_first <= src_last);
+
+		if constexpr (PlasticSynapse<Syn>) {
+			SPICE_PRE(src_last <= _ages.size());
+
+			// Rows are independent: Every one of them has its own age and edges.
+			Int const rows = 256;
+			pool.parallel_for((src_last - src_first + rows - 1) / rows, [&](Int const block) {
+				Int const first = src_first + block * rows;
+				_update<false>(time, dt, util::range(first, std::min(first + rows, src_last)),
+				               util::empty_t{}, util::empty_t{}, dst_history, -1);
+			});
+		}
 	}
 
 	Int delay() const override { return _delay; }
 
+	void place(util::numa_policy const policy) override {
+		_graph.place(policy);
+		if constexpr (PlasticSynapse<Syn>)
+			util::numa_place(std::span(_ages), policy);
+	}
+
+	std::vector<util::numa_placement> placement() const override {
+		auto result = _graph.placement();
+		if constexpr (PlasticSynapse<Syn>)
+			result.push_back(util::numa_pages("ages", std::span(_ages)));
+		return result;
+	}
+
+	topology_memory memory(bool const structure) const override {
+		return _graph.memory(structure);
+	}
+	std::shared_ptr<csr_structure> const& structure() const override { return _graph.structure(); }
+
+	// Renumbering of the destination population, see snn::finalize()
+	void first_touch(std::vector<Int32>& order, std::vector<bool>& seen) const override {
+		_graph.first_touch(order, seen);
+	}
+	void relabel(std::span<Int32 const> index, util::thread_pool& pool) override {
+		_graph.relabel_destinations(index, pool);
+
+		if (_procedural) {
+			if (_index.empty())
+				_index.assign(index.begin(), index.end());
+			else
+				for (Int32& i : _index)
+					i = index[i];
+		}
+	}
+
+	// Everything but the structure of the graph (see snn::save()) and the generator of
+	// procedural connections, which are restored by constructing the population. Like the
+	// instance of Neur in neuron populations, _syn is included if it can be copied as is.
+	void save(util::checkpoint_writer& out) const override {
+		if constexpr (std::is_trivially_copyable_v<Syn>)
+			out.write_value(_syn);
+		_graph.save(out);
+		if constexpr (PlasticSynapse<Syn>)
+			out.write(_ages);
+		out.write(_index);
+	}
+	void load(util::checkpoint_reader& in) override {
+		if constexpr (std::is_trivially_copyable_v<Syn>)
+			in.read_value(_syn);
+		_graph.load(in);
+		if constexpr (PlasticSynapse<Syn>)
+			in.read(std::span(_ages));
+		in.read(_index);
+	}
+
 private:
+	using graph_t = detail::csr<synapse_traits_t<Syn>>;
+
 	Syn _syn;
-	detail::csr<synapse_traits_t<Syn>> _graph;
+	graph_t _graph;
 	Int _delay;
 	[[no_unique_address]] util::optional_t<std::vector<UInt>, PlasticSynapse<Syn>> _ages;
+	Int _bucket_size;
+	// The yet to be delivered edges of every spike, one list per destination part (see
+	// csr::partition()), reused across steps
+	struct row {
+		Int32 src;
+		typename decltype(_graph)::iterator first;
+		typename decltype(_graph)::iterator last;
+	};
+	std::vector<std::vector<row>> _rows;
+	// Procedural delivery: the rows of the current step's spikes (max_degree slots each) and
+	// their degrees, and the destinations' new ids once relabel()ed (if ever)
+	row_generator _procedural;
+	std::vector<Int32> _generated;
+	std::vector<Int> _degrees;
+	std::vector<Int32> _index;
+
+	// Regenerates the rows of all 'spikes' in parallel, sorted by (relabeled) destination
+	void _generate(std::span<Int32 const> spikes, util::thread_pool& pool) {
+		Int const n = _procedural.max_degree;
+		_generated.resize(spikes.size() * n);
+		_degrees.resize(spikes.size());
+
+		Int const rows = 16;
+		pool.parallel_for((spikes.size() + rows - 1) / rows, [&](Int const block) {
+			for (Int const i : util::range(block * rows, std::min<Int>((block + 1) * rows,
+			                                                           spikes.size()))) {
+				std::span<Int32> const dsts(_generated.data() + i * n, n);
+				_degrees[i] = _procedural.row(spikes[i], dsts);
+				if (!_index.empty()) {
+					for (Int32& dst : dsts.first(_degrees[i]))
+						dst = _index[dst];
+					std::sort(dsts.begin(), dsts.begin() + _degrees[i]);
+				}
+			}
+		});
+	}
+
+	// Delivers the generated rows, only to the destinations in block 'part' (see _update())
+	void _deliver_generated(std::span<Int32 const> spikes, auto&& src_neurons, auto&& dst_neurons,
+	                        Int const part) {
+		if constexpr (!StatefulSynapse<Syn>) {
+			auto const dsts = _graph.destinations(part);
+			for (Int const i : util::range(spikes)) {
+				Int32 const* const first = _generated.data() + i * _procedural.max_degree;
+				Int32 const* const last  = first + _degrees[i];
+				for (auto it = std::lower_bound(first, last, *dsts.begin());
+				     it != last && *it < *dsts.end(); ++it)
+					_deliver(spikes[i], *it, nullptr, src_neurons, dst_neurons);
+			}
+		}
+	}
 
+	// Processes the neighbors of all sources in 'spikes', either all of them (part = -1), or only
+	// the ones inside destination block 'part'. In the latter case it's the caller's
+	// responsibility to update _ages once all parts have been processed.
 	template <bool Deliver>
-	void _update(Int const time, float const dt, auto spikes, auto src_neurons,
-	             std::span<typename DstNeur::neuron> dst_neurons,
-	             std::span<UInt const> dst_history) {
+	void _update(Int const time, float const dt, auto spikes, auto&& src_neurons,
+	             auto&& dst_neurons, std::span<UInt const> dst_history, Int const part) {
 		static_assert(Deliver || PlasticSynapse<Syn>);
 
+		bool const bucketed = Deliver && _bucket_size > 0;
+		auto* const rows    = bucketed ? &_rows[std::max<Int>(part, 0)] : nullptr;
+
 		for (auto src : spikes) {
 			bool pre = false;
 			Int age  = time + 1;
@@ -92,14 +329,24 @@ private:
 				pre = _ages[src] >> 63;
 				age = _ages[src] & ~(1_u64 << 63);
 			}
+			// Steps age + pre..time (bits time - age - pre..0 of history_at(.., time)) are left for
+			// the post-synaptic loop below. There are none if a pre-synaptic update covers 'time'.
 			Int const prefix = 63 + pre - time + age;
-			UInt const mask  = ~0_u64 >> prefix;
+			UInt const mask  = prefix < 64 ? ~0_u64 >> prefix : 0;
+
+			auto const edges = part < 0 ? _graph.neighbors(src) : _graph.neighbors(src, part);
+			if constexpr (Deliver)
+				if (bucketed)
+					rows->push_back({static_cast<Int32>(src), edges.begin(), edges.end()});
 
 			util::invoke(pre, time >= age, [&]<bool Pre, bool Outdated>() {
-				for (auto edge : _graph.neighbors(src)) {
+				if (bucketed && !(PlasticSynapse<Syn> && Outdated))
+					return;
+
+				for (auto edge : edges) {
 					if constexpr (PlasticSynapse<Syn> && Outdated) {
 						SPICE_INV(edge.first < dst_history.size());
-						UInt hist = dst_history[edge.first];
+						UInt hist = history_at(dst_history[edge.first], time);
 						if constexpr (Pre)
 							_syn.update(*edge.second, dt, true, hist & (1_u64 << (time - age)));
 
@@ -115,28 +362,58 @@ private:
 						_syn.skip(*edge.second, dt, 64 - p);
 					}
 
-					if constexpr (Deliver) {
-						SPICE_INV(edge.first < dst_neurons.size());
-						if constexpr (DeliverTo<Syn, DstNeur>) {
-							if constexpr (StatefulSynapse<Syn>)
-								_syn.deliver(*edge.second, dst_neurons[edge.first]);
-							else
-								_syn.deliver(dst_neurons[edge.first]);
-						} else {
-							SPICE_INV(src < src_neurons.size());
-							if constexpr (StatefulSynapse<Syn>)
-								_syn.deliver(*edge.second, src_neurons[src],
-								             dst_neurons[edge.first]);
-							else
-								_syn.deliver(src_neurons[src], dst_neurons[edge.first]);
-						}
-					}
+					if constexpr (Deliver)
+						if (!bucketed)
+							_deliver(src, edge.first, edge.second, src_neurons, dst_neurons);
 				}
 			});
 
 			if constexpr (PlasticSynapse<Syn>)
-				_ages[src] = (time + 1) | (UInt(Deliver) << 63);
+				if (part < 0)
+					_ages[src] = (time + 1) | (UInt(Deliver) << 63);
 		}
+
+		if constexpr (Deliver) {
+			if (bucketed) {
+				// Every row resumes where the previous bucket left off
+				auto const dst = _graph.destinations(part);
+				for (Int first = *dst.begin(); first < *dst.end(); first += _bucket_size) {
+					Int const last = first + _bucket_size;
+					for (row& r : *rows) {
+						auto it = r.first;
+						for (; it != r.last; ++it) {
+							auto const edge = *it;
+							if (edge.first >= last)
+								break;
+							_deliver(r.src, edge.first, edge.second, src_neurons, dst_neurons);
+						}
+						r.first = it;
+					}
+				}
+				rows->clear();
+			}
+		}
+	}
+
+	void _deliver(auto const src, Int const dst, auto const syn, auto&& src_neurons,
+	              auto&& dst_neurons) {
+		SPICE_INV(dst < dst_neurons.size());
+		util::apply_at(dst_neurons, dst, [&](auto& to) {
+			if constexpr (DeliverTo<Syn, DstNeur>) {
+				if constexpr (StatefulSynapse<Syn>)
+					_syn.deliver(*syn, to);
+				else
+					_syn.deliver(to);
+			} else {
+				SPICE_INV(src < src_neurons.size());
+				util::apply_at(src_neurons, src, [&](auto const& from) {
+					if constexpr (StatefulSynapse<Syn>)
+						_syn.deliver(*syn, from, to);
+					else
+						_syn.deliver(from, to);
+				});
+			}
+		});
 	}
 };
 }
\ No newline at end of file
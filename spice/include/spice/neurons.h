@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "spice/util/assert.h"
+#include "spice/util/random.h"
+#include "spice/util/range.h"
+#include "spice/util/stdint.h"
+
+namespace spice {
+// Neurons firing independently at 'rate' Hz (homogeneous Poisson process). Instead of drawing a
+// number for every neuron, spike indices are sampled directly by skipping geometrically
+// distributed gaps (like fixed_probability does for edges), so an update costs O(#spikes)
+// rather than O(#neurons). 'rate' may be changed in between steps, see
+// neuron_population::get_neuron().
+struct poisson_source {
+	float rate = 0; // Hz
+
+	void update(Int const first, Int const last, float const dt, auto& rng,
+	            std::vector<Int32>& out_spikes) const {
+		SPICE_PRE(rate >= 0);
+
+		double const p = static_cast<double>(rate) * dt;
+		if (p <= 0)
+			return;
+		if (p >= 1) {
+			for (Int const i : util::range(first, last))
+				out_spikes.push_back(i);
+			return;
+		}
+
+		// Number of silent neurons in front of the next spiking one ~ Geometric(p)
+		double const scale = 1 / std::log1p(-p);
+		for (Int i = first;; i++) {
+			double const gap =
+			    std::floor(std::log(util::generate_canonical<double, true>(rng)) * scale);
+			i += static_cast<Int>(std::min(gap, static_cast<double>(last - i)));
+			if (i >= last)
+				break;
+			out_spikes.push_back(i);
+		}
+	}
+};
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spice/detail/neuron_population.h"
+#include "spice/util/stdint.h"
+
+namespace spice {
+// Records the spikes of a set of populations to a binary file. record() merely copies the spikes
+// into a chunk. Full chunks are handed over to a background thread, which encodes and writes
+// them while the simulation fills the next one (double buffering).
+//
+// File format, where every number is a varint (LEB128, 7 bits per byte):
+// - Header: "SPKR", version (1), population count, the size of every population
+// - One record per step with at least one spike: the difference to the previous such step
+//   (initially -1), then for every population its spike count, followed by the differences
+//   between its consecutive spikes (the first one relative to 0), zigzag-encoded.
+// Spikes keep their order, ids sorted in increasing order take about one byte each.
+class spike_recorder {
+public:
+	// Steps are numbered in the order they're recorded, from 0. Chunks hold 'chunk_size' spikes.
+	spike_recorder(std::string const& path,
+	               std::vector<detail::NeuronPopulation const*> populations,
+	               Int const chunk_size = 1 << 18);
+	// Flushes
+	~spike_recorder();
+
+	spike_recorder(spike_recorder const&)            = delete;
+	spike_recorder& operator=(spike_recorder const&) = delete;
+
+	// Appends the spikes of the last 'steps' steps (spikes(steps - 1), ..., spikes(0)). Only the
+	// last max_delay steps are kept, so longer runs have to be recorded in pieces, e.g. by
+	// alternating snn::run(k) and record(k) for some k <= max_delay.
+	void record(Int const steps = 1);
+	// Waits until everything recorded so far has been written. Rethrows errors of the writer.
+	void flush();
+
+private:
+	// Consecutive steps [first_step, first_step + counts.size() / populations)
+	struct chunk {
+		Int first_step = 0;
+		// Spikes of every (step, population), in this order
+		std::vector<Int32> counts;
+		std::vector<Int32> ids;
+	};
+
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> _file;
+	std::vector<detail::NeuronPopulation const*> _populations;
+	Int _chunk_size;
+	Int _step = 0;
+	chunk _front; // filled by record()
+	chunk _back;  // written by _writer
+
+	std::mutex _mutex;
+	std::condition_variable _changed;
+	bool _pending = false; // _back holds a chunk yet to be written
+	bool _done    = false;
+	std::exception_ptr _error;
+	std::thread _writer;
+
+	// Hands _front over to the writer (once it's done with the previous chunk)
+	void _submit();
+	void _write();
+};
+
+// Reads files written by spike_recorder
+class spike_reader {
+public:
+	explicit spike_reader(std::string const& path);
+
+	std::vector<Int> const& sizes() const { return _sizes; }
+
+	// Reads the next step with spikes into 'step' and 'spikes' (one list per population).
+	// Returns false at the end of the file.
+	bool next(Int& step, std::vector<std::vector<Int32>>& spikes);
+
+private:
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> _file;
+	std::vector<Int> _sizes;
+	Int _step = -1;
+
+	// Returns false at the end of the file
+	bool _read(UInt& x);
+};
+}
\ No newline at end of file
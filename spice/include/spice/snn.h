@@ -1,27 +1,98 @@
 #pragma once
 
+#include <cstddef>
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "spice/concepts.h"
 #include "spice/detail/neuron_population.h"
 #include "spice/detail/synapse_population.h"
+#include "spice/neurons.h"
 #include "spice/topology.h"
+#include "spice/util/checkpoint.h"
+#include "spice/util/numa.h"
 #include "spice/util/numeric.h"
 #include "spice/util/random.h"
 #include "spice/util/stdint.h"
+#include "spice/util/task_graph.h"
+#include "spice/util/thread_pool.h"
+#include "spice/util/transport.h"
 #include "spice/util/type_traits.h"
 
 namespace spice {
 class snn {
 public:
-	snn(float const dt, float const max_delay, util::seed_seq seed) :
-	_dt(dt), _max_delay(std::round(max_delay / dt)), _seed(std::move(seed)) {}
+	snn(float const dt, float const max_delay, util::seed_seq seed, Int const threads = 1) :
+	_dt(dt),
+	_max_delay(std::round(max_delay / dt)),
+	_seed(std::move(seed)),
+	_pool(std::make_unique<util::thread_pool>(threads)) {}
+
+	// Sets the number of threads (including the calling thread) used to simulate the network.
+	// The simulation produces identical results regardless of the thread count.
+	void set_threads(Int const threads);
+	Int threads() const { return _pool->size(); }
+
+	// Places the storage of all (current and future) populations and connections according to
+	// 'policy'. With numa_policy::partition, threads are also pinned to NUMA nodes s.t. every
+	// worker updates and receives spikes for the neurons stored on its own node.
+	void set_numa_policy(util::numa_policy const policy);
+	util::numa_policy numa_policy() const { return _numa; }
+	// By default, plastic connections catch up on all of their synapses every 64 steps. When
+	// staggered, they instead catch up on 1/64th of their sources every step, which flattens the
+	// step latency. Results differ slightly (in floating-point rounding).
+	void set_staggered_plasticity(bool const staggered) { _staggered_plasticity = staggered; }
+	bool staggered_plasticity() const { return _staggered_plasticity; }
+	// Where the storage of every population and connection landed, e.g. "population 0: neurons"
+	std::vector<util::numa_placement> placement() const;
+	// Memory taken by the structure of all connections, see detail::csr. Structures shared by
+	// several connections count once.
+	topology_memory memory() const;
+
+	// Distributes the simulation across the processes ("ranks") connected by 'transport'
+	// (which must outlive the snn). Must be called before adding any populations. Every rank
+	// builds the exact same network (same calls, same seed) but only updates its own slice of
+	// every population and only generates, initializes and stores the synapses targeting that
+	// slice (neuron state, which is small in comparison, is still allocated in full). Spikes are
+	// exchanged once every min_delay steps. Spikes are identical to those of a single-process
+	// simulation, but the deliveries of the last step of a run() are deferred to the next call
+	// to run().
+	// Connections reading the state of their source neurons (DeliverFromTo) are not supported.
+	void distribute(util::transport& transport);
+
+	// Checkpoints: save() writes the complete state of the network (neurons, spikes and spike
+	// histories, connections incl. their structure, time and seed) to a single file, see
+	// util::checkpoint_writer. To resume from it, construct an snn with the same arguments, call
+	// load(), then declare the exact same network again (same calls, in the same order): Every
+	// population and connection then takes its state straight from the mapped file. Neither
+	// are topologies generated (nor reordered, see finalize()), nor are neurons and synapses
+	// initialized (see PerNeuronInit, PerPopulationInit and PerSynapseInit). The simulation
+	// continues bit-identical to one that was never interrupted. Not supported for distributed
+	// simulations, nor for neurons or synapses whose state isn't trivially copyable (save()
+	// throws std::runtime_error).
+	void save(std::string const& path);
+	void load(std::string const& path);
 
 	template <Neuron Neur>
 	detail::neuron_population<Neur>* add_population(Int const size, Neur neur = {}) {
-		_neurons.push_back(std::make_unique<detail::neuron_population<Neur>>(std::move(neur), size,
-		                                                                     _seed, _max_delay));
+		SPICE_PRE(!_finalized && "Populations must be added before finalize().");
+		auto* const restore =
+		    _checkpoint ? &_restore(_checkpoint->populations, _neurons.size()) : nullptr;
+		_neurons.push_back(std::make_unique<detail::neuron_population<Neur>>(
+		    std::move(neur), size, _seed, _max_delay, restore));
+		_schedules.clear();
+
+		if (_transport) {
+			Int const rank  = _transport->rank();
+			Int const ranks = _transport->size();
+			if (_neurons.back()->own(size * rank / ranks, size * (rank + 1) / ranks))
+				_exchanged.push_back(_neurons.size() - 1);
+		}
+
+		if (_numa != util::numa_policy::local)
+			_neurons.back()->place(_numa);
 
 		return static_cast<detail::neuron_population<Neur>*>(_neurons.back().get());
 	}
@@ -30,18 +101,52 @@ public:
 	requires Synapse<Syn, SrcNeur, DstNeur>
 	void connect(detail::neuron_population<SrcNeur>* source,
 	             detail::neuron_population<DstNeur>* target, Topology& c, float const delay,
-	             Syn syn = {}) {
+	             Syn syn = {}, delivery const mode = delivery::scatter) {
 		Int const d = std::round(delay / _dt);
 		SPICE_PRE(d >= 1 && "The delay must be at least 1dt.");
 		SPICE_PRE(
 		    d <= _max_delay &&
 		    "The delay of a synapse population may not exceed the maximum delay of the network.");
+		SPICE_PRE(!(_transport && DeliverFromTo<Syn, SrcNeur, DstNeur>) &&
+		          "Distributed simulations don't support reading from source neurons.");
+		SPICE_PRE(!_finalized && "Connections must be added before finalize().");
+		SPICE_PRE(!(mode == delivery::procedural && StatefulSynapse<Syn>) &&
+		          "Only stateless synapses support procedural delivery.");
+
+		// Connections with identical rows share them (until either gets modified, e.g. reordered
+		// by finalize()). Distributed simulations only generate the synapses targeting their
+		// own slice of 'target'.
+		c(source->size(), target->size());
+		bool const procedural = mode == delivery::procedural;
+		std::string const key = procedural || _transport ? "" : c.fingerprint(_seed);
+		auto structure        = key.empty() ? nullptr : _structures[key].lock();
+		if (_checkpoint)
+			structure = _restore_structure();
+
+		Int dst_first = 0;
+		Int dst_last  = -1;
+		if (_transport) {
+			Int const rank  = _transport->rank();
+			Int const ranks = _transport->size();
+			dst_first       = target->size() * rank / ranks;
+			dst_last        = target->size() * (rank + 1) / ranks;
+		}
 
-		_synapses.push_back(std::unique_ptr<detail::SynapsePopulation>(
-		    new detail::synapse_population<Syn, SrcNeur, DstNeur>(
-		        std::move(syn), c(source->size(), target->size()), _seed, d)));
+		using synapse_population = detail::synapse_population<Syn, SrcNeur, DstNeur>;
+		_synapses.push_back(std::unique_ptr<detail::SynapsePopulation>(new synapse_population(
+		    std::move(syn), c, _seed, d, *_pool,
+		    mode == delivery::bucketed ? synapse_population::default_bucket_size : 0, procedural,
+		    std::move(structure), _checkpoint ? _checkpoint->file.get() : nullptr, dst_first,
+		    dst_last)));
+		if (!key.empty())
+			_structures[key] = _synapses.back()->structure();
 
-		_connections.push_back({source, _synapses.back().get(), target});
+		_connections.push_back({source, _synapses.back().get(), target,
+		                        DeliverFromTo<Syn, SrcNeur, DstNeur>, PlasticSynapse<Syn>});
+		_schedules.clear();
+
+		if (_numa != util::numa_policy::local)
+			_synapses.back()->place(_numa);
 
 		if constexpr (PlasticSynapse<Syn>)
 			source->plastic();
@@ -51,17 +156,48 @@ public:
 	requires Synapse<Syn, SrcNeur, DstNeur>
 	void connect(detail::neuron_population<SrcNeur>* source,
 	             detail::neuron_population<DstNeur>* target, Topology&& c, float const delay,
-	             Syn syn = {}) {
-		connect<Syn, SrcNeur, DstNeur>(source, target, c, delay, std::move(syn));
+	             Syn syn = {}, delivery const mode = delivery::scatter) {
+		connect<Syn, SrcNeur, DstNeur>(source, target, c, delay, std::move(syn), mode);
 	}
 
+	// Optionally called once the network is complete, before simulating it. With 'reorder',
+	// renumbers the storage of every population targeted by connections s.t. neurons receiving
+	// spikes from the same sources end up next to each other (in the order in which the
+	// connections' rows first reference them), which makes delivery more cache friendly.
+	// Spikes keep referring to neurons by their original ids, get_neurons() is indexed via
+	// neuron_population::index(). Results are identical. Skipped for distributed simulations
+	// (whose slices are ranges of ids) and populations whose state synapses read.
+	void finalize(bool const reorder = true);
+
 	void step();
+	// Equivalent to calling step() 'steps' times, but faster: Spikes take at least min_delay
+	// steps to arrive, so run() simulates min_delay steps at a time and lets populations that do
+	// not depend on each other get up to min_delay steps ahead of one another, synchronizing all
+	// threads only once per block instead of once per step.
+	void run(Int const steps);
 
 private:
 	struct connection {
 		detail::NeuronPopulation* from     = nullptr;
 		detail::SynapsePopulation* synapse = nullptr;
 		detail::NeuronPopulation* to       = nullptr;
+		bool reads_source                  = false;
+		bool plastic                       = false;
+	};
+
+	// A unit of work inside run(): updating a population, catching up on a connection's
+	// plasticity, or delivering a connection's spikes during the given step of a block. In
+	// distributed simulations, deliveries are shifted by one step (to -1 .. steps - 2), so that
+	// a block only delivers spikes which have been exchanged already.
+	struct task {
+		enum { update, plasticity, deliver } kind;
+		Int index;
+		Int step;
+	};
+	// Dependency graph of all tasks of a block of steps
+	struct schedule {
+		std::vector<task> tasks;
+		util::task_graph graph;
 	};
 
 	Int _time = 0;
@@ -72,5 +208,39 @@ private:
 	std::vector<std::unique_ptr<detail::NeuronPopulation>> _neurons;
 	std::vector<std::unique_ptr<detail::SynapsePopulation>> _synapses;
 	std::vector<connection> _connections;
+	std::unique_ptr<util::thread_pool> _pool;
+	util::numa_policy _numa     = util::numa_policy::local;
+	bool _staggered_plasticity  = false;
+	bool _finalized             = false;
+	util::transport* _transport = nullptr;
+	// Populations split across ranks, whose spikes are exchanged
+	std::vector<Int> _exchanged;
+	std::vector<std::vector<std::byte>> _recv;
+	// Built lazily, keyed by block length
+	std::map<Int, schedule> _schedules;
+	// The structure of every connection, keyed by its topology's fingerprint
+	std::map<std::string, std::weak_ptr<detail::csr_structure>> _structures;
+	// The checkpoint being restored by add_population() and connect(), see load(). Time and seed
+	// are restored once the network is complete (by _resume()).
+	struct checkpoint {
+		std::unique_ptr<util::checkpoint_reader> file;
+		// The first section of every population and connection
+		std::vector<Int> populations;
+		std::vector<Int> connections;
+		Int time;
+		util::kahan_sum<float> simtime;
+		util::seed_seq seed;
+	};
+	std::unique_ptr<checkpoint> _checkpoint;
+
+	Int _min_delay() const;
+	schedule const& _schedule(Int const steps);
+	void _exchange(Int const steps);
+	// Positions the checkpoint at the i-th of 'sections'
+	util::checkpoint_reader& _restore(std::vector<Int> const& sections, Int const i);
+	// The structure of the next connection, which is either saved along with it or shared with
+	// a previous one
+	std::shared_ptr<detail::csr_structure> _restore_structure();
+	void _resume();
 };
 }
\ No newline at end of file
@@ -1,26 +1,57 @@
 #pragma once
 
+#include <functional>
 #include <span>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "spice/util/random.h"
 #include "spice/util/stdint.h"
+#include "spice/util/thread_pool.h"
 
 namespace spice {
+// Bytes taken by the structure of a connection (see detail::csr), and how many it would take with
+// full-width indices (Int offsets, Int32 neighbors)
+struct topology_memory {
+	Int bytes      = 0;
+	Int wide_bytes = 0;
+
+	topology_memory& operator+=(topology_memory const& other) {
+		bytes += other.bytes;
+		wide_bytes += other.wide_bytes;
+		return *this;
+	}
+};
+
 class edge_stream {
 public:
 	edge_stream(std::span<Int> offsets, std::span<Int32> neighbors);
+	// For at most 2^16 destinations
+	edge_stream(std::span<Int> offsets, std::span<UInt16> neighbors);
 	edge_stream& operator<<(std::pair<Int32, Int32> const edge);
 	void flush();
 
 private:
 	std::span<Int> _offsets;
+	// One of them is empty
 	std::span<Int32> _neighbors;
+	std::span<UInt16> _neighbors16;
 	Int _src = 0;
 	Int _dst = 0;
 };
 
+// Regenerates single rows of a topology on demand, see Topology::procedural()
+struct row_generator {
+	// Upper bound on the degree of any row
+	Int max_degree = 0;
+	// Writes the neighbors of row 'src' to 'out' (which has room for max_degree of them), in
+	// increasing order, and returns how many there are
+	std::function<Int(Int src, std::span<Int32> out)> row;
+
+	explicit operator bool() const { return bool(row); }
+};
+
 struct Topology {
 	Int src_count = 0;
 	Int dst_count = 0;
@@ -31,7 +62,27 @@ struct Topology {
 	virtual Int size() const = 0;
 	virtual void generate(edge_stream& stream, util::seed_seq const& seed);
 	virtual void generate(std::span<Int> offsets, std::span<Int32> neighbors,
-	                      util::seed_seq const& seed);
+	                      util::seed_seq const& seed, util::thread_pool& pool);
+	// Same, with narrow indices for at most 2^16 destinations (see detail::csr)
+	virtual void generate(std::span<Int> offsets, std::span<UInt16> neighbors,
+	                      util::seed_seq const& seed, util::thread_pool& pool);
+	// Only the edges targeting [dst_first, dst_last), see snn::distribute(). 'neighbors' is
+	// resized to fit them. By default, generates all edges and drops the others.
+	virtual void generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                            std::vector<Int32>& neighbors, util::seed_seq const& seed,
+	                            util::thread_pool& pool);
+	virtual void generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                            std::vector<UInt16>& neighbors, util::seed_seq const& seed,
+	                            util::thread_pool& pool);
+	// Topologies whose rows are pure functions of (src, seed) return a generator yielding the
+	// same rows as generate(), so that connections need not store them (see
+	// delivery::procedural). All others return an empty one.
+	virtual row_generator procedural(util::seed_seq const& seed) const;
+	// Identifies the rows generate() produces for 'seed': Topologies with equal, non-empty
+	// fingerprints generate identical rows, so their connections share them (see snn::connect()).
+	// Empty (never shared) by default. Only adj_list overrides it: Random topologies get a
+	// distinct seed per connection, so their rows never match.
+	virtual std::string fingerprint(util::seed_seq const& seed) const;
 };
 
 class adj_list : public Topology {
@@ -40,9 +91,36 @@ public:
 
 	Int size() const override;
 	void generate(edge_stream& stream, util::seed_seq const& seed) override;
+	// Buckets edges by source (in parallel) and writes them straight into offsets/neighbors,
+	// without sorting or copying the edge list.
+	void generate(std::span<Int> offsets, std::span<Int32> neighbors, util::seed_seq const& seed,
+	              util::thread_pool& pool) override;
+	void generate(std::span<Int> offsets, std::span<UInt16> neighbors, util::seed_seq const& seed,
+	              util::thread_pool& pool) override;
+	// Counts the edges of the slice before scattering them, so 'neighbors' fits them exactly
+	void generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                    std::vector<Int32>& neighbors, util::seed_seq const& seed,
+	                    util::thread_pool& pool) override;
+	void generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                    std::vector<UInt16>& neighbors, util::seed_seq const& seed,
+	                    util::thread_pool& pool) override;
+	// Independent of the seed, so connecting the same adj_list twice shares its rows
+	std::string fingerprint(util::seed_seq const& seed) const override;
 
 private:
 	std::vector<UInt> _connections;
+	// Unique across all adj_lists. connect() only marks it outdated, fingerprint() renews it
+	// once per batch of edits.
+	mutable UInt _version = _new_version();
+	mutable bool _edited  = false;
+
+	static UInt _new_version();
+	// Counting sort of the edges targeting [dst_first, dst_last): _count() stores the degree of
+	// every row in offsets[src + 1], _scatter() turns them into offsets and fills 'neighbors'.
+	void _count(Int dst_first, Int dst_last, std::span<Int> offsets, util::thread_pool& pool);
+	template <class Neighbor>
+	void _scatter(Int dst_first, Int dst_last, std::span<Int> offsets,
+	              std::span<Neighbor> neighbors, util::thread_pool& pool);
 };
 
 class fixed_probability : public Topology {
@@ -50,10 +128,31 @@ public:
 	explicit fixed_probability(double const p);
 
 	Int size() const override;
-	void generate(std::span<Int> offsets, std::span<Int32> neighbors,
-	              util::seed_seq const& seed) override;
+	// Every row draws from its own random stream, so the result does not depend on the number
+	// of threads in 'pool'.
+	void generate(std::span<Int> offsets, std::span<Int32> neighbors, util::seed_seq const& seed,
+	              util::thread_pool& pool) override;
+	void generate(std::span<Int> offsets, std::span<UInt16> neighbors, util::seed_seq const& seed,
+	              util::thread_pool& pool) override;
+	// Generates every row twice, first counting the neighbors inside the slice, then copying them
+	void generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                    std::vector<Int32>& neighbors, util::seed_seq const& seed,
+	                    util::thread_pool& pool) override;
+	void generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                    std::vector<UInt16>& neighbors, util::seed_seq const& seed,
+	                    util::thread_pool& pool) override;
+	row_generator procedural(util::seed_seq const& seed) const override;
 
 private:
 	double const _p;
+
+	Int _max_degree() const;
+	template <class Neighbor>
+	void _generate(std::span<Int> offsets, std::span<Neighbor> neighbors,
+	               util::seed_seq const& seed, util::thread_pool& pool);
+	template <class Neighbor>
+	void _generate_slice(Int dst_first, Int dst_last, std::span<Int> offsets,
+	                     std::vector<Neighbor>& neighbors, util::seed_seq const& seed,
+	                     util::thread_pool& pool);
 };
 }
\ No newline at end of file
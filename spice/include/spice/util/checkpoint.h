@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "spice/util/stdint.h"
+
+namespace spice::util {
+// Section alignment of checkpoint files, see checkpoint_writer
+constexpr Int checkpoint_alignment = 64;
+
+// Writes a checkpoint file: "SPCK", a version (1), then a sequence of sections. Every section is
+// its length in bytes (UInt) followed by its bytes, both starting at a multiple of
+// checkpoint_alignment (padded with zeros). Values are stored as is, in native byte order.
+class checkpoint_writer {
+public:
+	explicit checkpoint_writer(std::string const& path);
+
+	checkpoint_writer(checkpoint_writer const&)            = delete;
+	checkpoint_writer& operator=(checkpoint_writer const&) = delete;
+
+	// The number of sections written so far, i.e. the index of the next one
+	Int sections() const { return _sections; }
+
+	void write(std::span<std::byte const> bytes);
+	template <class T>
+	void write(std::span<T> const values) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		write(std::as_bytes(values));
+	}
+	template <class T>
+	void write(std::vector<T> const& values) {
+		write(std::span(values));
+	}
+	// Two sections: the size of every vector, then all of their elements
+	template <class T>
+	void write(std::vector<std::vector<T>> const& values) {
+		std::vector<Int> sizes;
+		std::vector<T> all;
+		for (auto const& v : values) {
+			sizes.push_back(v.size());
+			all.insert(all.end(), v.begin(), v.end());
+		}
+		write(sizes);
+		write(all);
+	}
+	template <class T>
+	void write_value(T const& value) {
+		write(std::span(&value, 1));
+	}
+
+	// Flushes the file, reporting errors (while the destructor ignores them)
+	void close();
+
+private:
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> _file;
+	Int _size     = 0;
+	Int _sections = 0;
+
+	void _write(void const* data, Int bytes);
+	void _align();
+};
+
+// Reads checkpoint files by mapping them into memory. Opening one merely locates its sections,
+// which can then be viewed in place (see section()) or copied out in bulk, in any order.
+// Mismatches between the expected and the actual layout throw std::runtime_error.
+class checkpoint_reader {
+public:
+	explicit checkpoint_reader(std::string const& path);
+	~checkpoint_reader();
+
+	checkpoint_reader(checkpoint_reader const&)            = delete;
+	checkpoint_reader& operator=(checkpoint_reader const&) = delete;
+
+	Int sections() const { return _sections.size(); }
+	// The index of the next section read
+	Int tell() const { return _next; }
+	void seek(Int section);
+
+	// The next section, as an array of T (pointing into the mapping)
+	template <class T = std::byte>
+	std::span<T const> section() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		auto const bytes = _section();
+		if (bytes.size() % sizeof(T) != 0)
+			_mismatch();
+		return {reinterpret_cast<T const*>(bytes.data()), bytes.size() / sizeof(T)};
+	}
+
+	// Into a buffer of exactly the section's size
+	template <class T>
+	void read(std::span<T> const out) {
+		auto const values = section<T>();
+		if (values.size() != out.size())
+			_mismatch();
+		std::copy(values.begin(), values.end(), out.begin());
+	}
+	template <class T>
+	void read(std::vector<T>& out) {
+		auto const values = section<T>();
+		out.assign(values.begin(), values.end());
+	}
+	// See checkpoint_writer::write(std::vector<std::vector<T>> const&)
+	template <class T>
+	void read(std::vector<std::vector<T>>& out) {
+		auto const sizes  = section<Int>();
+		auto const values = section<T>();
+		out.resize(sizes.size());
+		UInt first = 0;
+		for (Int i = 0; i < static_cast<Int>(sizes.size()); i++) {
+			if (sizes[i] < 0 || first + sizes[i] > values.size())
+				_mismatch();
+			out[i].assign(values.begin() + first, values.begin() + first + sizes[i]);
+			first += sizes[i];
+		}
+		if (first != values.size())
+			_mismatch();
+	}
+	template <class T>
+	void read_value(T& value) {
+		read(std::span(&value, 1));
+	}
+	template <class T>
+	T read_value() {
+		T result;
+		read_value(result);
+		return result;
+	}
+
+private:
+	std::byte const* _data = nullptr;
+	Int _size              = 0;
+	std::vector<std::span<std::byte const>> _sections;
+	Int _next = 0;
+
+	std::span<std::byte const> _section();
+	// Unmaps the file and throws, for errors inside the constructor
+	[[noreturn]] void _fail(char const* what);
+	[[noreturn]] static void _mismatch();
+};
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "spice/util/stdint.h"
+
+namespace spice::util {
+// Where the pages of a buffer are placed on multi-socket (NUMA) machines
+enum class numa_policy {
+	// The kernel's default: Pages live on the node of the thread touching them first.
+	local,
+	// Pages are distributed round-robin across all nodes.
+	interleave,
+	// The buffer is split into one contiguous part per node, in order. Matches the contiguous
+	// chunks thread_pool::parallel_for() assigns to workers pinned via pin_to_numa_nodes().
+	partition
+};
+
+// Pages of a buffer resident on every node (index = node). Untouched pages are not counted.
+struct numa_placement {
+	std::string buffer;
+	std::vector<Int> pages;
+};
+
+Int numa_node_count();
+
+// Applies 'policy' to all pages overlapping [data, data + bytes) and migrates pages which have
+// already been touched. Best-effort: Does nothing if the system doesn't support NUMA.
+void numa_place(void const* data, Int const bytes, numa_policy const policy);
+template <class T>
+void numa_place(std::span<T> const buffer, numa_policy const policy) {
+	numa_place(buffer.data(), buffer.size_bytes(), policy);
+}
+
+std::vector<Int> numa_pages(void const* data, Int const bytes);
+template <class T>
+numa_placement numa_pages(std::string buffer, std::span<T> const data) {
+	return {std::move(buffer), numa_pages(data.data(), data.size_bytes())};
+}
+
+// The CPUs of 'node', none for memory-only nodes (e.g. CXL or HBM) or if unknown
+std::vector<Int> numa_cpus(Int const node);
+// Parses a list of CPUs as found in /sys/devices/system/node/node*/cpulist, e.g. "0-3,8-11\n".
+// Empty (as for memory-only nodes) or malformed entries are skipped.
+std::vector<Int> parse_cpulist(std::string const& list);
+
+// Restricts 'thread' to the CPUs of 'node'. Best-effort, like numa_place(): Does nothing for
+// nodes without CPUs.
+void numa_pin(pthread_t const thread, Int const node);
+}
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <concepts>
+#include <limits>
+
+#include "spice/util/stdint.h"
 
 namespace spice::util {
 template <std::floating_point Real>
@@ -22,4 +28,68 @@ private:
 	Real _c   = 0;
 	Real _sum = 0;
 };
+
+// Compact storage for floating-point state, e.g. the fields of Syn::synapse, which dominate the
+// memory (and bandwidth) of plastic connections. These types are read and written as float
+// (incl. compound assignment), so code written against float fields keeps working. Values are
+// rounded to the nearest representable one on every write.
+template <class T>
+class float_ops {
+public:
+	T& operator+=(float const x) { return _self() = float(_self()) + x; }
+	T& operator-=(float const x) { return _self() = float(_self()) - x; }
+	T& operator*=(float const x) { return _self() = float(_self()) * x; }
+	T& operator/=(float const x) { return _self() = float(_self()) / x; }
+
+private:
+	T& _self() { return static_cast<T&>(*this); }
+};
+
+// IEEE 754 half precision: 11 significant bits, |x| <= 65504
+class float16 : public float_ops<float16> {
+public:
+	float16() = default;
+	constexpr float16(float const x) : _x(x) {}
+
+	constexpr operator float() const { return _x; }
+
+private:
+	_Float16 _x = 0;
+};
+
+// The upper half of a float: 8 significant bits, same range as float
+class bfloat16 : public float_ops<bfloat16> {
+public:
+	bfloat16() = default;
+	constexpr bfloat16(float const x) {
+		// Round to nearest, ties to even
+		UInt32 const bits = std::bit_cast<UInt32>(x);
+		_bits             = (bits + 0x7FFF + ((bits >> 16) & 1)) >> 16;
+	}
+
+	constexpr operator float() const { return std::bit_cast<float>(UInt32(_bits) << 16); }
+
+private:
+	UInt16 _bits = 0;
+};
+
+// Fixed point: the 8- or 16-bit integer I times Scale, e.g. fixed<UInt16, 3e-4f / 65535>
+// covers [0, 3e-4] in 65536 steps. Values outside of I's range saturate.
+template <std::integral I, float Scale>
+class fixed : public float_ops<fixed<I, Scale>> {
+public:
+	static_assert(sizeof(I) <= 2 && Scale > 0);
+
+	fixed() = default;
+	constexpr fixed(float const x) {
+		float const min = std::numeric_limits<I>::min();
+		float const max = std::numeric_limits<I>::max();
+		_x              = static_cast<I>(std::clamp(std::round(x / Scale), min, max));
+	}
+
+	constexpr operator float() const { return _x * Scale; }
+
+private:
+	I _x = 0;
+};
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cmath>
 #include <concepts>
 #include <initializer_list>
@@ -8,9 +10,11 @@
 #include <limits>
 #include <numbers>
 #include <random>
+#include <span>
 #include <type_traits>
 
 #include "spice/util/assert.h"
+#include "spice/util/simd.h"
 #include "spice/util/stdint.h"
 
 namespace spice::util {
@@ -233,6 +237,115 @@ struct xoroshiro64_128p : public xoroshiro<UInt, 128> {
 	}
 };
 
+// 'Lanes' independent xoroshiro64_128p generators advanced in lock-step inside SIMD registers
+// (4 lanes = one AVX2 register). Lane l is seeded with seed.stream(l) and produces the same
+// sequence as xoroshiro64_128p(seed.stream(l)). Every call returns one number per lane. Lanes
+// should not exceed the target's register width (otherwise GCC warns about the return ABI).
+template <Int Lanes = 4>
+class xoroshiro64_128p_lanes {
+public:
+	using result_type = simd<UInt, Lanes>;
+
+	explicit xoroshiro64_128p_lanes(seed_seq const& seed) {
+		for (Int l = 0; l < Lanes; l++) {
+			UInt128 const s = seed.stream(l).seed();
+			_s0[l]          = s.lo;
+			_s1[l]          = s.hi;
+		}
+	}
+
+	result_type operator()() {
+		result_type const result = _s0 + _s1;
+
+		result_type const tmp = _s0 ^ _s1;
+		_s0                   = _rotate(_s0, 24) ^ tmp ^ (tmp << 16);
+		_s1                   = _rotate(tmp, 37);
+
+		return result;
+	}
+
+	// Numbers in [0, 1) (or (0, 1] if LeftOpen) from a single call: one double or two floats
+	// per lane, with full precision (53 resp. 24 random bits each). See generate_canonical().
+	template <std::floating_point Real, bool LeftOpen = false>
+	auto canonical() {
+		static_assert(std::is_same_v<Real, float> || std::is_same_v<Real, double>);
+		constexpr Int digits = std::numeric_limits<Real>::digits;
+		constexpr Real scale = Real(1) / Real(1_u64 << digits);
+
+		if constexpr (std::is_same_v<Real, float>) {
+			auto const bits = std::bit_cast<simd<UInt32, 2 * Lanes>>((*this)()) >> (32 - digits);
+			return __builtin_convertvector(
+			           __builtin_convertvector(bits, simd<Int32, 2 * Lanes>) + LeftOpen,
+			           simd<float, 2 * Lanes>) *
+			       scale;
+		} else {
+			auto const bits = (*this)() >> (64 - digits);
+			return __builtin_convertvector(
+			           __builtin_convertvector(bits, simd<Int, Lanes>) + LeftOpen,
+			           simd<double, Lanes>) *
+			       scale;
+		}
+	}
+
+private:
+	result_type _s0;
+	result_type _s1;
+
+	static result_type _rotate(result_type const x, Int const k) {
+		return (x << k) | (x >> (64 - k));
+	}
+};
+
+// Counter-based generator (Philox4x32-10, Salmon et al., "Parallel random numbers: as easy as
+// 1, 2, 3", 2011). The n-th number of a stream is a pure function of (seed, stream, n), so
+// streams are cheap to create and independent of each other: Every neuron can draw from its own
+// stream, in any order and on any thread, with bit-identical results.
+class philox4x32_10 {
+public:
+	using result_type = UInt;
+
+	constexpr explicit philox4x32_10(seed_seq const& seed, UInt32 const stream = 0) :
+	_key{static_cast<UInt32>(seed.seed().lo), static_cast<UInt32>(seed.seed().lo >> 32)},
+	_counter{0, stream, static_cast<UInt32>(seed.seed().hi),
+	         static_cast<UInt32>(seed.seed().hi >> 32)} {}
+
+	constexpr UInt min() { return 0; }
+	constexpr UInt max() { return std::numeric_limits<UInt>::max(); }
+
+	constexpr UInt operator()() {
+		if (_index == 0) {
+			_block = block(_counter, _key);
+			_counter[0]++;
+		}
+
+		UInt const result = _block[_index] | UInt(_block[_index + 1]) << 32;
+		_index            = (_index + 2) % 4;
+		return result;
+	}
+
+	using counter_t = std::array<UInt32, 4>;
+	using key_t     = std::array<UInt32, 2>;
+
+	// The underlying bijection
+	static constexpr counter_t block(counter_t c, key_t k) {
+		for (Int i = 0; i < 10; i++) {
+			UInt const p0 = UInt(0xD2511F53) * c[0];
+			UInt const p1 = UInt(0xCD9E8D57) * c[2];
+
+			c = {static_cast<UInt32>(p1 >> 32) ^ c[1] ^ k[0], static_cast<UInt32>(p1),
+			     static_cast<UInt32>(p0 >> 32) ^ c[3] ^ k[1], static_cast<UInt32>(p0)};
+			k = {k[0] + 0x9E3779B9, k[1] + 0xBB67AE85};
+		}
+		return c;
+	}
+
+private:
+	key_t _key;
+	counter_t _counter;
+	counter_t _block{};
+	Int _index = 0;
+};
+
 template <std::floating_point Real, bool LeftOpen = false>
 constexpr Real generate_canonical(auto& rng) {
 	constexpr std::size_t rng_size = sizeof(decltype(rng()));
@@ -246,6 +359,29 @@ constexpr Real generate_canonical(auto& rng) {
 	       Real(1_u64 << digits);
 }
 
+// Fills 'out' with numbers in [0, 1) (or (0, 1] if LeftOpen). Multi-lane generators (such as
+// xoroshiro64_128p_lanes) produce several numbers per call.
+template <std::floating_point Real, bool LeftOpen = false>
+void generate_canonical(auto& rng, std::span<Real> const out) {
+	if constexpr (requires { rng.template canonical<Real, LeftOpen>(); }) {
+		using batch     = decltype(rng.template canonical<Real, LeftOpen>());
+		constexpr Int n = sizeof(batch) / sizeof(Real);
+
+		Int i = 0;
+		for (; i + n <= out.size(); i += n)
+			store(out.data() + i, rng.template canonical<Real, LeftOpen>());
+
+		if (i < out.size()) {
+			batch const x = rng.template canonical<Real, LeftOpen>();
+			for (Int j = 0; i + j < out.size(); j++)
+				out[i + j] = x[j];
+		}
+	} else {
+		for (Real& x : out)
+			x = generate_canonical<Real, LeftOpen>(rng);
+	}
+}
+
 template <std::floating_point Real, bool LeftOpen = false>
 class uniform_real_distribution {
 public:
@@ -255,6 +391,12 @@ public:
 	constexpr Real operator()(auto& rng) const {
 		return std::fma(generate_canonical<Real, LeftOpen>(rng), _scale, _offset);
 	}
+	// Fills 'out'
+	void operator()(auto& rng, std::span<Real> const out) const {
+		generate_canonical<Real, LeftOpen>(rng, out);
+		for (Real& x : out)
+			x = std::fma(x, _scale, _offset);
+	}
 
 private:
 	Real _offset = 0;
@@ -270,6 +412,12 @@ public:
 	constexpr Real operator()(auto& rng) const {
 		return -_scale * std::log(generate_canonical<Real, true>(rng));
 	}
+	// Fills 'out'
+	void operator()(auto& rng, std::span<Real> const out) const {
+		generate_canonical<Real, true>(rng, out);
+		for (Real& x : out)
+			x = -_scale * std::log(x);
+	}
 
 private:
 	Real _scale;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+
+#ifdef __BMI2__
+	#include <immintrin.h>
+#endif
+
+#include "spice/util/stdint.h"
+
+namespace spice::util {
+// Number of lanes processed at once by batch updates (see PerBatchUpdate): 8 floats = one AVX2
+// register.
+constexpr Int simd_width = 8;
+
+// N lanes of type F (GCC vector extension). Supports arithmetic, comparisons (yielding lane
+// masks of 0/-1), the ternary operator, and subscripting.
+template <class F, Int N = simd_width>
+struct simd_type {
+	typedef F type __attribute__((vector_size(N * sizeof(F))));
+};
+template <class F, Int N = simd_width>
+using simd = typename simd_type<F, N>::type;
+
+// Unaligned load/store of N consecutive values
+template <class F, Int N = simd_width>
+simd<F, N> load(F const* const from) {
+	simd<F, N> result;
+	std::memcpy(&result, from, sizeof(result));
+	return result;
+}
+template <class F, class V>
+void store(F* const to, V const x) {
+	static_assert(sizeof(x) % sizeof(F) == 0);
+	std::memcpy(to, &x, sizeof(x));
+}
+
+// Converts a lane mask (as returned by comparisons) into a bitmask: bit l is set iff lane l is.
+template <class M>
+UInt32 to_bitmask(M const mask) {
+	UInt32 result = 0;
+	for (Int l = 0; l < simd_width; l++)
+		result |= UInt32(mask[l] != 0) << l;
+	return result;
+}
+
+// Writes base + l for every set bit l of 'mask' to out (in increasing order) and returns the
+// number of set bits. Branch-free: always writes simd_width elements, so 'out' must have room
+// for that many.
+inline Int compress(UInt32 const mask, Int32 const base, Int32* const out) {
+	static_assert(simd_width <= 8);
+#ifdef __BMI2__
+	// Spread the mask's bits into bytes, then gather the byte indices of the set bits.
+	UInt const bytes   = _pdep_u64(mask, 0x0101010101010101) * 0xFF;
+	UInt const indices = _pext_u64(0x0706050403020100, bytes);
+	for (Int l = 0; l < simd_width; l++)
+		out[l] = base + Int32((indices >> (8 * l)) & 0xFF);
+#else
+	Int n = 0;
+	for (Int l = 0; l < simd_width; l++) {
+		out[n] = base + Int32(l);
+		n += (mask >> l) & 1;
+	}
+#endif
+	return std::popcount(mask);
+}
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "boost/hana.hpp"
+
+#include "spice/util/assert.h"
+#include "spice/util/simd.h"
+#include "spice/util/stdint.h"
+
+namespace spice::util {
+// Structs whose members are visible to Boost.Hana, i.e. which are defined via
+// BOOST_HANA_DEFINE_STRUCT or adapted via BOOST_HANA_ADAPT_STRUCT.
+template <class T>
+concept Reflectable = boost::hana::Struct<T>::value && std::default_initializable<T> &&
+                      std::is_trivially_copyable_v<T>;
+
+template <Reflectable T>
+constexpr Int field_count = decltype(boost::hana::length(boost::hana::accessors<T>()))::value;
+
+template <Reflectable T, Int I>
+using field_t = std::remove_cvref_t<decltype(boost::hana::second(
+    boost::hana::at_c<I>(boost::hana::accessors<T>()))(std::declval<T&>()))>;
+
+// Whether Batch holds one util::simd<F> for every member F of T, in the same order
+template <class Batch, class T>
+constexpr bool is_batch_of() {
+	if constexpr (Reflectable<Batch> && Reflectable<T>) {
+		if constexpr (field_count<Batch> == field_count<T>)
+			return []<Int... I>(std::integer_sequence<Int, I...>) {
+				return (std::is_same_v<field_t<Batch, I>, simd<field_t<T, I>>> && ...);
+			}(std::make_integer_sequence<Int, field_count<T>>{});
+	}
+	return false;
+}
+
+// Stores every member of T in an array of its own (structure of arrays), so loops touching
+// the same member of consecutive elements access contiguous memory and can be vectorized.
+// Elements are read and written as a whole (load(), store(), or the proxy returned by
+// operator[]); once inlined, the compiler only keeps the member accesses that are needed.
+template <Reflectable T>
+class soa_vector {
+public:
+	class reference {
+	public:
+		reference(soa_vector& v, Int const i) : _v(v), _i(i) {}
+
+		operator T() const { return _v.load(_i); }
+		reference& operator=(T const& x) {
+			_v.store(_i, x);
+			return *this;
+		}
+
+		// Accesses a single member, e.g. v[i][BOOST_HANA_STRING("V")]
+		template <class Key>
+		auto& operator[](Key) const {
+			return _v.template field<_index_of<Key>()>()[_i];
+		}
+
+	private:
+		soa_vector& _v;
+		Int _i;
+	};
+
+	explicit soa_vector(Int const size = 0) { resize(size); }
+
+	Int size() const { return _size; }
+	// New elements are default-initialized (honoring T's default member initializers)
+	void resize(Int const size) {
+		SPICE_PRE(size >= 0);
+		T const x{};
+		_for_each_index([&]<Int I>() {
+			auto& old  = std::get<I>(_fields);
+			auto field = std::make_unique_for_overwrite<field_t<T, I>[]>(size);
+			std::copy_n(old.get(), std::min(_size, size), field.get());
+			std::fill(field.get() + std::min(_size, size), field.get() + size, _accessor<I>()(x));
+			old = std::move(field);
+		});
+		_size = size;
+	}
+
+	// Unchecked, so loops over elements remain vectorizable
+	T load(Int const i) const {
+		T result;
+		_for_each_index([&]<Int I>() { _accessor<I>()(result) = std::get<I>(_fields)[i]; });
+		return result;
+	}
+	void store(Int const i, T const& x) {
+		_for_each_index([&]<Int I>() { std::get<I>(_fields)[i] = _accessor<I>()(x); });
+	}
+
+	// Loads elements [i, i + n), n <= simd_width, into a batch: a reflectable struct holding a
+	// util::simd<F> for every member F of T, in the same order (see is_batch_of). Lanes >= n
+	// are default-initialized.
+	template <class Batch>
+	Batch load_batch(Int const i, Int const n) const {
+		SPICE_INV(0 <= n && n <= simd_width && i + n <= size());
+		Batch result;
+		T const x{};
+		_for_each_index([&]<Int I>() {
+			auto& lanes       = _accessor<I, Batch>()(result);
+			auto const* field = std::get<I>(_fields).get() + i;
+			if (n == simd_width)
+				lanes = util::load(field);
+			else
+				for (Int l = 0; l < simd_width; l++)
+					lanes[l] = l < n ? field[l] : _accessor<I>()(x);
+		});
+		return result;
+	}
+	// Stores lanes [0, n) of 'batch' to elements [i, i + n)
+	template <class Batch>
+	void store_batch(Int const i, Int const n, Batch const& batch) {
+		SPICE_INV(0 <= n && n <= simd_width && i + n <= size());
+		_for_each_index([&]<Int I>() {
+			auto const& lanes = _accessor<I, Batch>()(batch);
+			auto* field       = std::get<I>(_fields).get() + i;
+			if (n == simd_width)
+				util::store(field, lanes);
+			else
+				for (Int l = 0; l < n; l++)
+					field[l] = lanes[l];
+		});
+	}
+
+	reference operator[](Int const i) { return {*this, i}; }
+	T operator[](Int const i) const { return load(i); }
+
+	template <Int I>
+	std::span<field_t<T, I>> field() {
+		return {std::get<I>(_fields).get(), static_cast<UInt>(_size)};
+	}
+	template <Int I>
+	std::span<field_t<T, I> const> field() const {
+		return {std::get<I>(_fields).get(), static_cast<UInt>(_size)};
+	}
+
+	// Invokes f(name, field) for every member of T, in declaration order. 'field' is a span
+	// over the member's values.
+	void for_each_field(auto&& f) {
+		_for_each_index([&]<Int I>() { f(_name<I>(), field<I>()); });
+	}
+	void for_each_field(auto&& f) const {
+		_for_each_index([&]<Int I>() { f(_name<I>(), field<I>()); });
+	}
+
+private:
+	template <class = std::make_integer_sequence<Int, field_count<T>>>
+	struct fields;
+	// Plain arrays rather than std::vector, which is specialized for bool
+	template <Int... I>
+	struct fields<std::integer_sequence<Int, I...>> {
+		using type = std::tuple<std::unique_ptr<field_t<T, I>[]>...>;
+	};
+
+	typename fields<>::type _fields;
+	Int _size = 0;
+
+	template <Int I, class U = T>
+	static constexpr auto _accessor() {
+		return boost::hana::second(boost::hana::at_c<I>(boost::hana::accessors<U>()));
+	}
+	template <Int I>
+	static constexpr char const* _name() {
+		return boost::hana::to<char const*>(
+		    boost::hana::first(boost::hana::at_c<I>(boost::hana::accessors<T>())));
+	}
+
+	template <class Key>
+	static constexpr Int _index_of() {
+		Int result = -1;
+		_for_each_index([&]<Int I>() {
+			if constexpr (std::is_same_v<std::remove_cvref_t<decltype(boost::hana::first(
+			                                 boost::hana::at_c<I>(boost::hana::accessors<T>())))>,
+			                             Key>)
+				result = I;
+		});
+		SPICE_INV(result >= 0);
+		return result;
+	}
+
+	static constexpr void _for_each_index(auto&& f) {
+		[&]<Int... I>(std::integer_sequence<Int, I...>) {
+			(f.template operator()<I>(), ...);
+		}(std::make_integer_sequence<Int, field_count<T>>{});
+	}
+};
+
+// Invokes f with a reference to element i of an array of structs or a soa_vector. The latter
+// hands f a copy of the element, which is stored back afterwards (unless 'v' is const). This
+// lets code written against T& (such as neuron and synapse callbacks) work with both layouts.
+template <class T>
+void apply_at(std::span<T> const v, Int const i, auto&& f) {
+	f(v[i]);
+}
+template <class T>
+void apply_at(soa_vector<T>& v, Int const i, auto&& f) {
+	T x = v.load(i);
+	f(x);
+	v.store(i, x);
+}
+template <class T>
+void apply_at(soa_vector<T> const& v, Int const i, auto&& f) {
+	T const x = v.load(i);
+	f(x);
+}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "spice/util/stdint.h"
+#include "spice/util/thread_pool.h"
+
+namespace spice::util {
+// Directed acyclic graph of tasks. Build it once, then run it (repeatedly) on a thread pool:
+// Every task is started as soon as all of its predecessors have completed.
+class task_graph {
+public:
+	// Adds a task and returns its id. Ids are consecutive, starting at 0.
+	Int add();
+	// Makes 'then' wait for 'first' to complete.
+	void precede(Int const first, Int const then);
+
+	Int size() const;
+	std::vector<Int> const& successors(Int const task) const;
+	Int predecessor_count(Int const task) const;
+
+	// Invokes fn(i) for every task i, respecting the dependencies. Returns once all tasks have
+	// completed.
+	template <class F>
+	void run(thread_pool& pool, F&& fn) const {
+		using Fn = std::remove_reference_t<F>;
+		_run(
+		    pool, [](void* f, Int const i) { (*static_cast<Fn*>(f))(i); },
+		    const_cast<void*>(static_cast<void const*>(&fn)));
+	}
+
+private:
+	std::vector<std::vector<Int>> _successors;
+	std::vector<Int> _predecessor_counts;
+
+	void _run(thread_pool& pool, void (*invoke)(void*, Int), void* fn) const;
+};
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "spice/util/stdint.h"
+
+namespace spice::util {
+// Persistent, work-stealing pool of worker threads. Every thread owns a task queue. Threads
+// process their own queue first (LIFO) and steal from the other threads' queues (FIFO) once it
+// runs dry. The calling thread always participates in the work, so a pool of size 1 spawns no
+// threads at all and runs everything inline. A pool may only be driven by one (external) thread
+// at a time.
+class thread_pool {
+public:
+	struct task {
+		void (*invoke)(void*, Int);
+		void* ctx;
+		Int arg;
+	};
+
+	explicit thread_pool(Int const nthreads = 1);
+	~thread_pool();
+
+	thread_pool(thread_pool const&)            = delete;
+	thread_pool& operator=(thread_pool const&) = delete;
+
+	Int size() const;
+
+	// Pins worker t to the (t * k / size())-th of the k NUMA nodes with CPUs, skipping
+	// memory-only ones. The calling thread (t = 0) is left alone; it should already run on the
+	// first of them.
+	void pin_to_numa_nodes();
+
+	// Invokes fn(i) for all i in [0, n) and returns once all invocations have completed
+	// (aka. a barrier). The order of invocations is unspecified. Initially, every thread is
+	// assigned a contiguous chunk of [0, n). May be called recursively from within fn: Waiting
+	// threads help out with pending work instead of blocking.
+	template <class F>
+	void parallel_for(Int const n, F&& fn) {
+		if (n <= 0)
+			return;
+
+		if (n == 1 || size() == 1) {
+			for (Int i = 0; i < n; i++)
+				fn(i);
+		} else {
+			using Fn = std::remove_reference_t<F>;
+			struct {
+				Fn* fn;
+				job j;
+			} ctx{&fn, {n}};
+
+			auto const invoke = [](void* c, Int const i) {
+				auto& cc = *static_cast<decltype(ctx)*>(c);
+				cc.j.run([&] { (*cc.fn)(i); });
+			};
+
+			for (Int t = 0; t < size(); t++)
+				for (Int i = (t + 1) * n / size() - 1; i >= t * n / size(); i--)
+					_push({invoke, &ctx, i}, t);
+			_notify();
+
+			ctx.j.wait(*this);
+		}
+	}
+
+	// Low-level interface for building other parallel constructs (see task_graph):
+	// Queues t on the calling thread's queue.
+	void spawn(task const t);
+	// Processes queued tasks until 'remaining' drops to zero.
+	void wait(std::atomic<Int> const& remaining);
+
+	// Tracks the completion of a group of tasks and the first exception thrown by any of them.
+	struct job {
+		std::atomic<Int> remaining;
+		std::exception_ptr error{};
+		std::atomic_flag failed{};
+
+		// Invokes f, captures any exception, and marks one task as completed.
+		// Must be the invoking thread's last access to the job.
+		void run(auto&& f) {
+			try {
+				f();
+			} catch (...) {
+				if (!failed.test_and_set())
+					error = std::current_exception();
+			}
+			remaining.fetch_sub(1, std::memory_order_acq_rel);
+		}
+
+		void wait(thread_pool& pool) {
+			pool.wait(remaining);
+			if (error)
+				std::rethrow_exception(error);
+		}
+	};
+
+private:
+	struct queue {
+		std::mutex mtx;
+		std::deque<task> tasks;
+	};
+
+	std::vector<std::thread> _workers;
+	std::unique_ptr<queue[]> _queues;
+	std::atomic<Int> _queued = 0;
+	std::mutex _sleep_mtx;
+	std::condition_variable _cv;
+	bool _stop = false;
+
+	Int _id() const;
+	void _push(task const t, Int const queue);
+	void _notify();
+	bool _run_one(Int const id);
+	void _work(Int const id);
+};
+}
\ No newline at end of file
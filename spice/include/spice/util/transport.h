@@ -0,0 +1,66 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "spice/util/stdint.h"
+
+namespace spice::util {
+// Moves data between the processes ("ranks") of a distributed simulation (see snn::distribute()).
+class transport {
+public:
+	// Accumulated over all calls to all_gather()
+	struct stats {
+		Int exchanges  = 0;
+		Int bytes      = 0; // sent and received
+		double seconds = 0;
+	};
+
+	virtual ~transport()     = default;
+	virtual Int rank() const = 0;
+	virtual Int size() const = 0;
+
+	// Collective operation, must be called by all ranks: Every rank contributes 'send'. On
+	// return, 'recv[r]' holds rank r's contribution (including this rank's).
+	void all_gather(std::span<std::byte const> send, std::vector<std::vector<std::byte>>& recv);
+
+	stats const& statistics() const { return _stats; }
+
+protected:
+	virtual void _all_gather(std::span<std::byte const> send,
+	                         std::vector<std::vector<std::byte>>& recv) = 0;
+
+private:
+	stats _stats;
+};
+
+// Connects processes on the same machine via (Unix domain) socket pairs.
+class socket_transport : public transport {
+public:
+	// Forks the calling process into 'ranks' processes, all connected to each other, and returns
+	// each process's own endpoint. The calling process becomes rank 0; it waits for all other
+	// ranks to exit when its endpoint is destroyed.
+	static std::unique_ptr<socket_transport> fork(Int const ranks);
+	~socket_transport();
+
+	socket_transport(socket_transport const&)            = delete;
+	socket_transport& operator=(socket_transport const&) = delete;
+
+	Int rank() const override;
+	Int size() const override;
+
+private:
+	Int _rank;
+	std::vector<int> _peers; // One socket per rank, -1 for ourselves
+	std::vector<pid_t> _children;
+
+	socket_transport(Int const rank, std::vector<int> peers, std::vector<pid_t> children);
+
+	void _all_gather(std::span<std::byte const> send,
+	                 std::vector<std::vector<std::byte>>& recv) override;
+};
+}
@@ -0,0 +1,220 @@
+#include "spice/recorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+
+#include "spice/util/assert.h"
+#include "spice/util/range.h"
+
+using namespace spice;
+
+[[noreturn]] static void throw_errno(char const* what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+static void put_varint(std::vector<unsigned char>& bytes, UInt x) {
+	for (; x >= 0x80; x >>= 7)
+		bytes.push_back(static_cast<unsigned char>(x | 0x80));
+	bytes.push_back(static_cast<unsigned char>(x));
+}
+
+static void write(std::FILE* const file, std::vector<unsigned char> const& bytes) {
+	if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size())
+		throw_errno("fwrite");
+}
+
+spike_recorder::spike_recorder(std::string const& path,
+                               std::vector<detail::NeuronPopulation const*> populations,
+                               Int const chunk_size) :
+_file(std::fopen(path.c_str(), "wb"), std::fclose),
+_populations(std::move(populations)),
+_chunk_size(chunk_size) {
+	SPICE_PRE(chunk_size > 0);
+	if (!_file)
+		throw_errno("fopen");
+
+	std::vector<unsigned char> header{'S', 'P', 'K', 'R'};
+	put_varint(header, 1);
+	put_varint(header, _populations.size());
+	for (auto const* pop : _populations) {
+		SPICE_PRE(pop);
+		put_varint(header, pop->size());
+	}
+	write(_file.get(), header);
+
+	_writer = std::thread([this] { _write(); });
+}
+
+spike_recorder::~spike_recorder() {
+	try {
+		flush();
+	} catch (...) {
+		// Only flush() reports errors
+	}
+
+	{
+		std::lock_guard lock(_mutex);
+		_done = true;
+	}
+	_changed.notify_all();
+	_writer.join();
+}
+
+void spike_recorder::record(Int const steps) {
+	SPICE_PRE(steps >= 0);
+	for (auto const* pop : _populations)
+		SPICE_PRE(steps <= pop->max_delay());
+
+	for (Int age = steps - 1; age >= 0; age--) {
+		if (_front.counts.empty())
+			_front.first_step = _step;
+		for (auto const* pop : _populations) {
+			auto const spikes = pop->spikes(age);
+			_front.counts.push_back(spikes.size());
+			_front.ids.insert(_front.ids.end(), spikes.begin(), spikes.end());
+		}
+		_step++;
+
+		if (static_cast<Int>(std::max(_front.ids.size(), _front.counts.size())) >= _chunk_size)
+			_submit();
+	}
+}
+
+void spike_recorder::flush() {
+	if (!_front.counts.empty())
+		_submit();
+
+	std::unique_lock lock(_mutex);
+	_changed.wait(lock, [&] { return !_pending; });
+	if (_error)
+		std::rethrow_exception(_error);
+	if (std::fflush(_file.get()) != 0)
+		throw_errno("fflush");
+}
+
+void spike_recorder::_submit() {
+	{
+		std::unique_lock lock(_mutex);
+		_changed.wait(lock, [&] { return !_pending; });
+		if (_error)
+			std::rethrow_exception(_error);
+
+		std::swap(_front, _back);
+		_pending = true;
+	}
+	_changed.notify_all();
+
+	_front.counts.clear();
+	_front.ids.clear();
+}
+
+void spike_recorder::_write() {
+	std::vector<unsigned char> bytes;
+	Int last_step = -1;
+
+	std::unique_lock lock(_mutex);
+	for (;;) {
+		_changed.wait(lock, [&] { return _pending || _done; });
+		if (!_pending)
+			return;
+		lock.unlock();
+
+		// _back belongs to this thread until _pending is reset
+		std::exception_ptr error;
+		try {
+			bytes.clear();
+			Int const n        = _populations.size();
+			Int32 const* spike = _back.ids.data();
+			for (Int i = 0; i < static_cast<Int>(_back.counts.size()); i += n) {
+				auto const counts = _back.counts.begin() + i;
+				if (std::accumulate(counts, counts + n, Int(0)) == 0)
+					continue;
+
+				Int const step = _back.first_step + i / n;
+				put_varint(bytes, step - last_step);
+				last_step = step;
+
+				for (Int const count : util::range(counts, counts + n)) {
+					put_varint(bytes, count);
+					Int32 prev = 0;
+					for (Int32 const* const end = spike + count; spike != end; spike++) {
+						Int const delta = Int(*spike) - prev;
+						put_varint(bytes, (UInt(delta) << 1) ^ UInt(delta >> 63));
+						prev = *spike;
+					}
+				}
+			}
+			write(_file.get(), bytes);
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		if (error)
+			_error = error;
+		_pending = false;
+		_changed.notify_all();
+	}
+}
+
+spike_reader::spike_reader(std::string const& path) :
+_file(std::fopen(path.c_str(), "rb"), std::fclose) {
+	if (!_file)
+		throw_errno("fopen");
+
+	char magic[4];
+	UInt version = 0;
+	UInt count   = 0;
+	if (std::fread(magic, 1, 4, _file.get()) != 4 || std::memcmp(magic, "SPKR", 4) != 0 ||
+	    !_read(version) || version != 1 || !_read(count))
+		throw std::runtime_error("spike_reader: not a spike file");
+
+	for (UInt size = 0; _sizes.size() < count; _sizes.push_back(size))
+		if (!_read(size))
+			throw std::runtime_error("spike_reader: truncated header");
+}
+
+bool spike_reader::next(Int& step, std::vector<std::vector<Int32>>& spikes) {
+	UInt x = 0;
+	if (!_read(x))
+		return false;
+
+	auto const read = [&] {
+		if (!_read(x))
+			throw std::runtime_error("spike_reader: truncated record");
+		return x;
+	};
+
+	_step += x;
+	step = _step;
+	spikes.resize(_sizes.size());
+	for (auto& ids : spikes) {
+		ids.resize(read());
+		Int32 prev = 0;
+		for (Int32& id : ids) {
+			UInt const z = read();
+			id           = prev + static_cast<Int32>(Int(z >> 1) ^ -Int(z & 1));
+			prev         = id;
+		}
+	}
+	return true;
+}
+
+bool spike_reader::_read(UInt& x) {
+	x = 0;
+	for (Int shift = 0;; shift += 7) {
+		int const c = std::getc(_file.get());
+		if (c == EOF) {
+			if (shift > 0)
+				throw std::runtime_error("spike_reader: truncated varint");
+			return false;
+		}
+		x |= UInt(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+}
\ No newline at end of file
@@ -1,28 +1,372 @@
 #include "spice/snn.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
 #include "spice/util/random.h"
 
 using namespace spice;
 
-void snn::step() {
-	float const dt = _simtime += _dt;
-	if (_simtime >= 1)
-		_simtime.reset();
+void snn::set_threads(Int const threads) {
+	_pool = std::make_unique<util::thread_pool>(threads);
+	if (_numa == util::numa_policy::partition)
+		_pool->pin_to_numa_nodes();
+}
 
-	util::xoroshiro64_128p rng(_seed++);
+void snn::set_numa_policy(util::numa_policy const policy) {
+	bool const repin = (policy == util::numa_policy::partition) !=
+	                   (_numa == util::numa_policy::partition);
+	_numa = policy;
+	if (repin)
+		set_threads(threads());
 
 	for (auto& pop : _neurons)
-		pop->update(_max_delay, dt, rng);
+		pop->place(policy);
+	for (auto& syn : _synapses)
+		syn->place(policy);
+}
+
+std::vector<util::numa_placement> snn::placement() const {
+	std::vector<util::numa_placement> result;
+	auto const append = [&](std::string const& prefix, auto const& placement) {
+		for (auto const& p : placement)
+			result.push_back({prefix + ": " + p.buffer, p.pages});
+	};
+
+	for (Int i : util::range(_neurons))
+		append("population " + std::to_string(i), _neurons[i]->placement());
+	for (Int i : util::range(_synapses))
+		append("connection " + std::to_string(i), _synapses[i]->placement());
+
+	return result;
+}
+
+topology_memory snn::memory() const {
+	topology_memory result;
+	std::set<detail::csr_structure const*> counted;
+	for (auto const& syn : _synapses)
+		result += syn->memory(counted.insert(syn->structure().get()).second);
+	return result;
+}
+
+void snn::distribute(util::transport& transport) {
+	SPICE_PRE(_neurons.empty() && "distribute() must be called before adding populations.");
+	SPICE_PRE(!_checkpoint && "Distributed simulations can't be restored from checkpoints.");
+	_transport = &transport;
+}
+
+// Populations, then connections (each preceded by the index of the connection whose structure
+// it shares, followed by that structure if it's its own), then a tail of five sections: time,
+// simulation time, seed, and the first section of every population and every connection.
+void snn::save(std::string const& path) {
+	SPICE_PRE(!_transport && "Distributed simulations can't be saved.");
+	_resume();
+
+	util::checkpoint_writer out(path);
+	std::vector<Int> populations;
+	for (auto const& pop : _neurons) {
+		populations.push_back(out.sections());
+		pop->save(out);
+	}
+
+	std::vector<Int> connections;
+	std::map<detail::csr_structure const*, Int> owners;
+	for (Int const i : util::range(_synapses)) {
+		auto const& syn = _synapses[i];
+		connections.push_back(out.sections());
+
+		auto const [owner, own] = owners.insert({syn->structure().get(), i});
+		out.write_value(owner->second);
+		if (own)
+			syn->structure()->save(out);
+		syn->save(out);
+	}
+
+	out.write_value(_time);
+	out.write_value(_simtime);
+	out.write_value(_seed);
+	out.write(populations);
+	out.write(connections);
+	out.close();
+}
+
+void snn::load(std::string const& path) {
+	SPICE_PRE(_neurons.empty() && "load() must be called before adding populations.");
+	SPICE_PRE(!_transport && "Distributed simulations can't be restored from checkpoints.");
+
+	auto file = std::make_unique<util::checkpoint_reader>(path);
+	if (file->sections() < 5)
+		throw std::runtime_error("snn::load: not a network checkpoint");
+	file->seek(file->sections() - 5);
+
+	auto const time    = file->read_value<Int>();
+	auto const simtime = file->read_value<util::kahan_sum<float>>();
+	util::seed_seq seed{0};
+	file->read_value(seed);
+	std::vector<Int> populations;
+	std::vector<Int> connections;
+	file->read(populations);
+	file->read(connections);
+
+	_checkpoint.reset(new checkpoint{std::move(file), std::move(populations),
+	                                 std::move(connections), time, simtime, seed});
+}
+
+void snn::finalize(bool const reorder) {
+	SPICE_PRE(!_finalized && "finalize() may only be called once.");
+	_finalized = true;
+
+	// A restored network already has the layout of the saved one
+	if (!reorder || _transport || _checkpoint)
+		return;
+
+	for (auto const& pop : _neurons) {
+		auto const targeted  = [&](connection const& c) { return c.to == pop.get(); };
+		auto const read_from = [&](connection const& c) {
+			return c.reads_source && c.from == pop.get();
+		};
+		if (std::none_of(_connections.begin(), _connections.end(), targeted) ||
+		    std::any_of(_connections.begin(), _connections.end(), read_from))
+			continue;
+
+		std::vector<Int32> order;
+		std::vector<bool> seen(pop->size());
+		for (auto const& c : _connections)
+			if (targeted(c))
+				c.synapse->first_touch(order, seen);
+		for (Int const i : util::range(pop->size()))
+			if (!seen[i])
+				order.push_back(i);
+
+		if (!pop->reorder(order))
+			continue;
+
+		std::vector<Int32> index(order.size());
+		for (Int const i : util::range(order))
+			index[order[i]] = i;
+		for (auto const& c : _connections)
+			if (targeted(c))
+				c.synapse->relabel(index, *_pool);
+	}
+}
+
+void snn::step() { run(1); }
+
+void snn::run(Int const steps) {
+	SPICE_PRE(steps >= 0);
+	_resume();
+
+	std::vector<float> dts;
+	std::vector<util::seed_seq> seeds;
+	for (Int done = 0; done < steps;) {
+		Int const block = std::min(steps - done, _min_delay());
+
+		dts.clear();
+		seeds.clear();
+		for (Int k = 0; k < block; k++) {
+			dts.push_back(_simtime += _dt);
+			if (_simtime >= 1)
+				_simtime.reset();
+
+			seeds.push_back(_seed++);
+		}
+
+		auto const& s = _schedule(block);
+		s.graph.run(*_pool, [&](Int const i) {
+			auto const& t  = s.tasks[i];
+			Int const time = _time + t.step;
+
+			switch (t.kind) {
+				case task::update: {
+					_neurons[t.index]->update(dts[t.step], seeds[t.step].stream(t.index), *_pool);
+				} break;
+
+				case task::plasticity: {
+					auto& c     = _connections[t.index];
+					Int const n = c.from->size();
+					Int const k = time % 64;
+					if (_staggered_plasticity)
+						c.synapse->update(time, _dt, k * n / 64, (k + 1) * n / 64, c.to->history(),
+						                  *_pool);
+					else if (k == 0)
+						c.synapse->update(time, _dt, 0, n, c.to->history(), *_pool);
+				} break;
+
+				case task::deliver: {
+					auto& c     = _connections[t.index];
+					Int const d = c.synapse->delay();
+					if (time >= d - 1)
+						c.synapse->deliver(time, _dt, c.from->spikes_at(time - (d - 1)),
+						                   c.from->neurons(), c.from->size(), c.to->neurons(),
+						                   c.to->size(), c.to->history(), *_pool);
+				} break;
+			}
+		});
+
+		_time += block;
+		done += block;
+
+		if (_transport)
+			_exchange(block);
+	}
+}
+
+// Sends the spikes of this rank's slices of all split populations for the last 'steps' steps
+// to all other ranks, and merges theirs. Ranks own consecutive slices, so concatenating the
+// spikes in rank order reproduces the (sorted) order of a single-process simulation.
+void snn::_exchange(Int const steps) {
+	std::vector<Int32> send;
+	for (Int const i : _exchanged)
+		for (Int const step : util::range(_time - steps, _time)) {
+			auto const spikes = _neurons[i]->spikes_at(step);
+			send.push_back(spikes.size());
+			send.insert(send.end(), spikes.begin(), spikes.end());
+		}
+
+	_transport->all_gather(std::as_bytes(std::span(send)), _recv);
+
+	std::vector<Int32 const*> cursors;
+	for (auto const& r : _recv)
+		cursors.push_back(reinterpret_cast<Int32 const*>(r.data()));
+
+	std::vector<Int32> merged;
+	for (Int const i : _exchanged)
+		for (Int const step : util::range(_time - steps, _time)) {
+			merged.clear();
+			for (auto& cursor : cursors) {
+				Int32 const count = *cursor++;
+				merged.insert(merged.end(), cursor, cursor + count);
+				cursor += count;
+			}
+			_neurons[i]->set_spikes(step, merged);
+		}
+}
+
+util::checkpoint_reader& snn::_restore(std::vector<Int> const& sections, Int const i) {
+	if (i >= static_cast<Int>(sections.size()))
+		throw std::runtime_error("snn::load: the network differs from the checkpoint");
+	_checkpoint->file->seek(sections[i]);
+	return *_checkpoint->file;
+}
+
+std::shared_ptr<detail::csr_structure> snn::_restore_structure() {
+	Int const i      = _synapses.size();
+	auto& in         = _restore(_checkpoint->connections, i);
+	auto const owner = in.read_value<Int>();
+	if (owner == i)
+		return detail::csr_structure::load(in);
+	if (owner < 0 || owner > i)
+		throw std::runtime_error("snn::load: corrupt checkpoint");
+	return _synapses[owner]->structure();
+}
+
+// Completes load() once the network has been declared
+void snn::_resume() {
+	if (!_checkpoint)
+		return;
+
+	if (_checkpoint->populations.size() != _neurons.size() ||
+	    _checkpoint->connections.size() != _synapses.size())
+		throw std::runtime_error("snn::load: the network differs from the checkpoint");
+	_time    = _checkpoint->time;
+	_simtime = _checkpoint->simtime;
+	_seed    = _checkpoint->seed;
+	_checkpoint.reset();
+}
+
+Int snn::_min_delay() const {
+	Int result = _max_delay;
+	for (auto const& c : _connections)
+		result = std::min(result, c.synapse->delay());
+	return result;
+}
+
+// Derives the dependencies between the tasks of a block from the data they access: Tasks are
+// visited in the order of a sequential simulation. Every task depends on the last task writing
+// any data it accesses, and, if it writes data itself, on all tasks reading that data since the
+// last write. Spikes are versioned by step (every step's spikes are written once and kept
+// around for max_delay steps), so deliveries only wait for the update that emitted their spikes.
+snn::schedule const& snn::_schedule(Int const steps) {
+	if (auto it = _schedules.find(steps); it != _schedules.end())
+		return it->second;
+
+	enum resource { neurons, spikes, history, edges };
+	struct access {
+		void const* data;
+		resource res;
+		bool write;
+		Int version = 0;
+	};
+	struct hazard {
+		Int last_write = -1;
+		std::vector<Int> reads;
+	};
+	std::map<std::tuple<void const*, resource, Int>, hazard> hazards;
+
+	auto& s  = _schedules[steps];
+	auto add = [&](task const t, std::vector<access> const& accesses) {
+		s.tasks.push_back(t);
+		Int const id = s.graph.add();
+
+		for (auto const& a : accesses) {
+			auto& h = hazards[{a.data, a.res, a.version}];
+			if (h.last_write >= 0 && h.last_write != id)
+				s.graph.precede(h.last_write, id);
+
+			if (a.write) {
+				for (Int const read : h.reads)
+					if (read != id)
+						s.graph.precede(read, id);
+
+				h.last_write = id;
+				h.reads.clear();
+			} else
+				h.reads.push_back(id);
+		}
+	};
+
+	auto const add_deliveries = [&](Int const k) {
+		for (Int i : util::range(_connections)) {
+			auto const& c = _connections[i];
+
+			std::vector<access> accesses{{c.to, history, false}, {c.synapse, edges, true}};
+			// Spikes emitted during a previous block are complete by now
+			if (Int const emitted = k - (c.synapse->delay() - 1); emitted >= 0)
+				accesses.push_back({c.from, spikes, false, emitted});
+			if (c.reads_source)
+				accesses.push_back({c.from, neurons, false});
+			accesses.push_back({c.to, neurons, true});
+
+			add({task::deliver, i, k}, accesses);
+		}
+	};
+
+	for (Int k = 0; k < steps; k++) {
+		if (_transport)
+			add_deliveries(k - 1);
+
+		for (Int i : util::range(_neurons)) {
+			auto const pop = _neurons[i].get();
+			add({task::update, i, k},
+			    {{pop, neurons, true}, {pop, spikes, true, k}, {pop, history, true}});
+		}
 
-	if (_time % 64 == 0)
-		for (auto& c : _connections)
-			c.synapse->update(_time, _dt, c.from->size(), c.to->history());
+		for (Int i : util::range(_connections)) {
+			auto const& c = _connections[i];
+			if (c.plastic)
+				add({task::plasticity, i, k}, {{c.to, history, false}, {c.synapse, edges, true}});
+		}
 
-	for (auto& c : _connections)
-		if (_time >= c.synapse->delay() - 1)
-			c.synapse->deliver(_time, _dt, c.from->spikes(c.synapse->delay() - 1),
-			                   c.from->neurons(), c.from->size(), c.to->neurons(), c.to->size(),
-			                   c.to->history());
+		if (!_transport)
+			add_deliveries(k);
+	}
 
-	_time++;
-}
\ No newline at end of file
+	return s;
+}
@@ -1,6 +1,7 @@
 #include "spice/topology.h"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 
 #include "spice/util/assert.h"
@@ -9,18 +10,32 @@
 
 using namespace spice;
 
+// The bytes of all 'values', concatenated
+static std::string bytes_of(auto const&... values) {
+	std::string result;
+	(result.append(reinterpret_cast<char const*>(&values), sizeof(values)), ...);
+	return result;
+}
+
 edge_stream::edge_stream(std::span<Int> offsets, std::span<Int32> neighbors) :
 _offsets(std::move(offsets)), _neighbors(std::move(neighbors)) {}
+edge_stream::edge_stream(std::span<Int> offsets, std::span<UInt16> neighbors) :
+_offsets(std::move(offsets)), _neighbors16(std::move(neighbors)) {}
 
 edge_stream& edge_stream::operator<<(std::pair<Int32, Int32> const edge) {
 	SPICE_PRE(_src < _offsets.size());
-	SPICE_PRE(_dst < _neighbors.size());
+	SPICE_PRE(_dst < std::max(_neighbors.size(), _neighbors16.size()));
 	SPICE_PRE(edge.first < _offsets.size());
 
 	while (_src <= edge.first)
 		_offsets[_src++] = _dst;
 
-	_neighbors[_dst++] = edge.second;
+	if (_neighbors16.empty())
+		_neighbors[_dst++] = edge.second;
+	else {
+		SPICE_PRE(edge.second <= std::numeric_limits<UInt16>::max());
+		_neighbors16[_dst++] = edge.second;
+	}
 
 	return *this;
 }
@@ -28,7 +43,8 @@ edge_stream& edge_stream::operator<<(std::pair<Int32, Int32> const edge) {
 void edge_stream::flush() {
 	SPICE_INV(_src < _offsets.size());
 	_offsets[_src] = _dst;
-	*this          = edge_stream(std::move(_offsets), std::move(_neighbors));
+	_src           = 0;
+	_dst           = 0;
 }
 
 Topology& Topology::operator()(Int const src_count_, Int const dst_count_) {
@@ -44,24 +60,89 @@ void Topology::generate(edge_stream&, util::seed_seq const&) {
 	SPICE_PRE(false && "Topology subclasses must implement generate(edge_stream, seed_seq)");
 }
 void Topology::generate(std::span<Int> offsets, std::span<Int32> neighbors,
-                        util::seed_seq const& seed) {
+                        util::seed_seq const& seed, util::thread_pool&) {
+	SPICE_PRE(offsets.size() > src_count);
+	SPICE_PRE(neighbors.size() >= size());
+
+	edge_stream es(offsets, neighbors);
+	generate(es, seed);
+	es.flush();
+}
+void Topology::generate(std::span<Int> offsets, std::span<UInt16> neighbors,
+                        util::seed_seq const& seed, util::thread_pool&) {
 	SPICE_PRE(offsets.size() > src_count);
 	SPICE_PRE(neighbors.size() >= size());
+	SPICE_PRE(dst_count <= std::numeric_limits<UInt16>::max() + 1);
 
 	edge_stream es(offsets, neighbors);
 	generate(es, seed);
 	es.flush();
 }
 
+// Generates all edges of 'c', then compacts every row to its neighbors inside the slice
+template <class Neighbor>
+static void generate_and_slice(Topology& c, Int const dst_first, Int const dst_last,
+                               std::span<Int> offsets, std::vector<Neighbor>& neighbors,
+                               util::seed_seq const& seed, util::thread_pool& pool) {
+	SPICE_PRE(offsets.size() > c.src_count);
+	SPICE_PRE(0 <= dst_first && dst_first <= dst_last && dst_last <= c.dst_count);
+
+	neighbors.resize(c.size());
+	c.generate(offsets, std::span(neighbors), seed, pool);
+
+	Int count = 0;
+	for (Int const src : util::range(c.src_count)) {
+		Int const first = offsets[src];
+		Int const last  = offsets[src + 1];
+		offsets[src]    = count;
+		for (Int const i : util::range(first, last))
+			if (dst_first <= neighbors[i] && neighbors[i] < dst_last)
+				neighbors[count++] = neighbors[i];
+	}
+	offsets[c.src_count] = count;
+
+	neighbors.resize(count);
+	neighbors.shrink_to_fit();
+}
+
+void Topology::generate_slice(Int const dst_first, Int const dst_last, std::span<Int> offsets,
+                              std::vector<Int32>& neighbors, util::seed_seq const& seed,
+                              util::thread_pool& pool) {
+	generate_and_slice(*this, dst_first, dst_last, offsets, neighbors, seed, pool);
+}
+void Topology::generate_slice(Int const dst_first, Int const dst_last, std::span<Int> offsets,
+                              std::vector<UInt16>& neighbors, util::seed_seq const& seed,
+                              util::thread_pool& pool) {
+	generate_and_slice(*this, dst_first, dst_last, offsets, neighbors, seed, pool);
+}
+
+row_generator Topology::procedural(util::seed_seq const&) const { return {}; }
+std::string Topology::fingerprint(util::seed_seq const&) const { return {}; }
+
 void adj_list::connect(Int const src, Int const dst) {
 	SPICE_PRE(0 <= src && src < std::numeric_limits<Int32>::max());
 	SPICE_PRE(0 <= dst && dst < std::numeric_limits<Int32>::max());
 
 	_connections.push_back(src << 32 | dst);
+	_edited = true;
 }
 
 Int adj_list::size() const { return _connections.size(); }
 
+// Sorting the connections (see generate()) doesn't change the rows, so it keeps the version.
+std::string adj_list::fingerprint(util::seed_seq const&) const {
+	if (_edited) {
+		_version = _new_version();
+		_edited  = false;
+	}
+	return "adj_list" + bytes_of(src_count, dst_count, size(), _version);
+}
+
+UInt adj_list::_new_version() {
+	static std::atomic<UInt> versions = 0;
+	return versions.fetch_add(1, std::memory_order_relaxed);
+}
+
 void adj_list::generate(edge_stream& stream, util::seed_seq const&) {
 	std::sort(_connections.begin(), _connections.end());
 
@@ -70,43 +151,247 @@ void adj_list::generate(edge_stream& stream, util::seed_seq const&) {
 	}
 }
 
-fixed_probability::fixed_probability(double const p) : _p(p) { SPICE_PRE(0 <= p && p <= 1); }
+void adj_list::generate(std::span<Int> offsets, std::span<Int32> neighbors,
+                        util::seed_seq const&, util::thread_pool& pool) {
+	SPICE_PRE(neighbors.size() >= size());
+	_count(0, dst_count, offsets, pool);
+	_scatter(0, dst_count, offsets, neighbors, pool);
+}
+void adj_list::generate(std::span<Int> offsets, std::span<UInt16> neighbors,
+                        util::seed_seq const&, util::thread_pool& pool) {
+	SPICE_PRE(neighbors.size() >= size());
+	SPICE_PRE(dst_count <= std::numeric_limits<UInt16>::max() + 1);
+	_count(0, dst_count, offsets, pool);
+	_scatter(0, dst_count, offsets, neighbors, pool);
+}
 
-Int fixed_probability::size() const {
-	Int const max_degree = dst_count * _p + 3 * std::sqrt(dst_count * _p * (1 - _p));
-	return src_count * max_degree;
+void adj_list::generate_slice(Int const dst_first, Int const dst_last, std::span<Int> offsets,
+                              std::vector<Int32>& neighbors, util::seed_seq const&,
+                              util::thread_pool& pool) {
+	_count(dst_first, dst_last, offsets, pool);
+	neighbors.resize(offsets[src_count]);
+	_scatter(dst_first, dst_last, offsets, std::span(neighbors), pool);
 }
+void adj_list::generate_slice(Int const dst_first, Int const dst_last, std::span<Int> offsets,
+                              std::vector<UInt16>& neighbors, util::seed_seq const&,
+                              util::thread_pool& pool) {
+	SPICE_PRE(dst_count <= std::numeric_limits<UInt16>::max() + 1);
+	_count(dst_first, dst_last, offsets, pool);
+	neighbors.resize(offsets[src_count]);
+	_scatter(dst_first, dst_last, offsets, std::span(neighbors), pool);
+}
+
+// Connections are processed in chunks of this many
+static Int const chunk_size = 1 << 16;
+
+static auto chunk(std::vector<UInt> const& connections, Int const i) {
+	Int const size = connections.size();
+	return util::range(connections.begin() + i * chunk_size,
+	                   connections.begin() + std::min((i + 1) * chunk_size, size));
+}
+
+void adj_list::_count(Int const dst_first, Int const dst_last, std::span<Int> offsets,
+                      util::thread_pool& pool) {
+	SPICE_PRE(offsets.size() > src_count);
+	SPICE_PRE(0 <= dst_first && dst_first <= dst_last && dst_last <= dst_count);
+
+	Int const chunks = (size() + chunk_size - 1) / chunk_size;
+
+	// 1. Count degrees into offsets[src + 1]
+	std::fill_n(offsets.begin(), src_count + 1, 0);
+	pool.parallel_for(chunks, [&](Int const i) {
+		for (auto const c : chunk(_connections, i)) {
+			Int const src = c >> 32;
+			Int const dst = c & 0xffffffff;
+			SPICE_PRE(src < src_count);
+			SPICE_PRE(dst < dst_count);
+			if (dst_first <= dst && dst < dst_last)
+				std::atomic_ref(offsets[src + 1]).fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// 2. Prefix sum => offsets[src] = first edge of src
+	for (Int const src : util::range(src_count))
+		offsets[src + 1] += offsets[src];
+}
+
+template <class Neighbor>
+void adj_list::_scatter(Int const dst_first, Int const dst_last, std::span<Int> offsets,
+                        std::span<Neighbor> neighbors, util::thread_pool& pool) {
+	SPICE_PRE(neighbors.size() >= static_cast<UInt>(offsets[src_count]));
+
+	Int const chunks = (size() + chunk_size - 1) / chunk_size;
+
+	// 3. Scatter, using offsets[src] as row src's cursor => offsets[src] = end of src
+	pool.parallel_for(chunks, [&](Int const i) {
+		for (auto const c : chunk(_connections, i)) {
+			Int const dst = c & 0xffffffff;
+			if (dst < dst_first || dst >= dst_last)
+				continue;
+
+			Int const edge =
+			    std::atomic_ref(offsets[c >> 32]).fetch_add(1, std::memory_order_relaxed);
+			neighbors[edge] = dst;
+		}
+	});
+
+	// 4. Shift offsets back and sort rows, whose order depends on the interleaving of threads
+	std::copy_backward(offsets.begin(), offsets.begin() + src_count,
+	                   offsets.begin() + src_count + 1);
+	offsets[0] = 0;
+
+	Int const rows = 1024;
+	pool.parallel_for((src_count + rows - 1) / rows, [&](Int const block) {
+		for (Int const src : util::range(block * rows, std::min((block + 1) * rows, src_count)))
+			std::sort(neighbors.begin() + offsets[src], neighbors.begin() + offsets[src + 1]);
+	});
+}
+
+// Row 'src' of fixed_probability: Skips ahead to every next neighbor by a geometrically
+// distributed distance (approximated by a rounded exponential one). Rows are truncated after
+// 'max_degree' neighbors.
+template <class Neighbor>
+static Int fixed_probability_row(Int const src, Int const dst_count, double const p,
+                                 Int const max_degree, util::seed_seq const& seed,
+                                 Neighbor* const row) {
+	if (dst_count == 0 || p == 0)
+		return 0;
+
+	util::exponential_distribution<double> exprnd(1 / p - 1);
+	util::xoroshiro64_128p rng(seed.stream(src));
+	Int32 index  = 0;
+	double noise = 0;
+	for (;;) {
+		noise += exprnd(rng);
+		Int32 const dst = index + static_cast<Int32>(std::round(noise));
+
+		if (__builtin_expect((dst >= dst_count) | (index >= max_degree), 0))
+			break;
+
+		SPICE_INV(dst < dst_count);
+
+		row[index++] = dst;
+	}
+	return index;
+}
+
+fixed_probability::fixed_probability(double const p) : _p(p) { SPICE_PRE(0 <= p && p <= 1); }
+
+Int fixed_probability::size() const { return src_count * _max_degree(); }
 
 void fixed_probability::generate(std::span<Int> offsets, std::span<Int32> neighbors,
-                                 util::seed_seq const& seed) {
+                                 util::seed_seq const& seed, util::thread_pool& pool) {
+	_generate(offsets, neighbors, seed, pool);
+}
+void fixed_probability::generate(std::span<Int> offsets, std::span<UInt16> neighbors,
+                                 util::seed_seq const& seed, util::thread_pool& pool) {
+	SPICE_PRE(dst_count <= std::numeric_limits<UInt16>::max() + 1);
+	_generate(offsets, neighbors, seed, pool);
+}
+
+void fixed_probability::generate_slice(Int const dst_first, Int const dst_last,
+                                       std::span<Int> offsets, std::vector<Int32>& neighbors,
+                                       util::seed_seq const& seed, util::thread_pool& pool) {
+	_generate_slice(dst_first, dst_last, offsets, neighbors, seed, pool);
+}
+void fixed_probability::generate_slice(Int const dst_first, Int const dst_last,
+                                       std::span<Int> offsets, std::vector<UInt16>& neighbors,
+                                       util::seed_seq const& seed, util::thread_pool& pool) {
+	SPICE_PRE(dst_count <= std::numeric_limits<UInt16>::max() + 1);
+	_generate_slice(dst_first, dst_last, offsets, neighbors, seed, pool);
+}
+
+template <class Neighbor>
+void fixed_probability::_generate(std::span<Int> offsets, std::span<Neighbor> neighbors,
+                                  util::seed_seq const& seed, util::thread_pool& pool) {
 	SPICE_PRE(offsets.size() > src_count);
 	SPICE_PRE(neighbors.size() >= size());
 
 	if (src_count == 0 || dst_count == 0 || _p == 0)
 		return;
 
-	util::xoroshiro64_128p rng(seed);
-	util::exponential_distribution<double> exprnd(1 / _p - 1);
+	Int const max_degree = _max_degree();
+	Int const block_size = 256;
 
-	Int const max_degree = size() / src_count;
-	Int count            = 0;
-	for (Int const src : util::range(src_count)) {
-		offsets[src] = count;
-		Int32 index  = 0;
-		double noise = 0;
-		for (;;) {
-			noise += exprnd(rng);
-			Int32 const dst = index + static_cast<Int32>(std::round(noise));
+	// 1. Generate every row at 'src * max_degree' (where it's guaranteed to fit), store its
+	// degree in 'offsets[src + 1]'.
+	pool.parallel_for((src_count + block_size - 1) / block_size, [&](Int const block) {
+		for (Int const src :
+		     util::range(block * block_size, std::min((block + 1) * block_size, src_count)))
+			offsets[src + 1] = fixed_probability_row(src, dst_count, _p, max_degree, seed,
+			                                         neighbors.data() + src * max_degree);
+	});
 
-			if (__builtin_expect((dst >= dst_count) | (index >= max_degree), 0))
-				break;
+	// 2. Prefix sum over degrees
+	offsets[0] = 0;
+	for (Int const src : util::range(src_count))
+		offsets[src + 1] += offsets[src];
 
-			SPICE_INV(src < src_count);
-			SPICE_INV(dst < dst_count);
+	// 3. Compact rows. Every row moves to the left by at least as much as its predecessor, so
+	// moving them in order never overwrites a row that hasn't moved yet.
+	for (Int const src : util::range(1, src_count)) {
+		auto const from = neighbors.begin() + src * max_degree;
+		auto const to   = neighbors.begin() + offsets[src];
+		if (from != to)
+			std::copy(from, from + (offsets[src + 1] - offsets[src]), to);
+	}
+}
 
-			neighbors[count++] = dst;
-			index++;
+template <class Neighbor>
+void fixed_probability::_generate_slice(Int const dst_first, Int const dst_last,
+                                        std::span<Int> offsets, std::vector<Neighbor>& neighbors,
+                                        util::seed_seq const& seed, util::thread_pool& pool) {
+	SPICE_PRE(offsets.size() > src_count);
+	SPICE_PRE(0 <= dst_first && dst_first <= dst_last && dst_last <= dst_count);
+
+	std::fill_n(offsets.begin(), src_count + 1, 0);
+	neighbors.clear();
+	if (src_count == 0 || dst_count == 0 || _p == 0)
+		return;
+
+	Int const max_degree = _max_degree();
+	Int const block_size = 256;
+	Int const blocks     = (src_count + block_size - 1) / block_size;
+	auto const rows      = [&](Int const block) {
+		return util::range(block * block_size, std::min((block + 1) * block_size, src_count));
+	};
+	// The neighbors of row 'src' inside the slice, generated into 'row'
+	auto const slice = [&](Int const src, std::vector<Int32>& row) {
+		auto const last = row.begin() + fixed_probability_row(src, dst_count, _p, max_degree,
+		                                                      seed, row.data());
+		auto const lo   = std::lower_bound(row.begin(), last, dst_first);
+		return util::range(lo, std::lower_bound(lo, last, dst_last));
+	};
+
+	// 1. Degrees into 'offsets[src + 1]', prefix sum
+	pool.parallel_for(blocks, [&](Int const block) {
+		std::vector<Int32> row(max_degree);
+		for (Int const src : rows(block))
+			offsets[src + 1] = slice(src, row).size();
+	});
+	for (Int const src : util::range(src_count))
+		offsets[src + 1] += offsets[src];
+
+	// 2. Regenerate every row, copying its slice
+	neighbors.resize(offsets[src_count]);
+	pool.parallel_for(blocks, [&](Int const block) {
+		std::vector<Int32> row(max_degree);
+		for (Int const src : rows(block)) {
+			auto const r = slice(src, row);
+			std::copy(r.begin(), r.end(), neighbors.begin() + offsets[src]);
 		}
-	}
-	offsets[src_count] = count;
+	});
+}
+
+row_generator fixed_probability::procedural(util::seed_seq const& seed) const {
+	Int const max_degree = _max_degree();
+	return {max_degree,
+	        [seed, max_degree, dst_count = dst_count, p = _p](Int const src, std::span<Int32> out) {
+		        SPICE_PRE(out.size() >= static_cast<UInt>(max_degree));
+		        return fixed_probability_row(src, dst_count, p, max_degree, seed, out.data());
+	        }};
+}
+
+Int fixed_probability::_max_degree() const {
+	return dst_count * _p + 3 * std::sqrt(dst_count * _p * (1 - _p));
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "spice/util/checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "spice/util/assert.h"
+
+using namespace spice;
+using namespace spice::util;
+
+static char const magic[4] = {'S', 'P', 'C', 'K'};
+static UInt32 const version = 1;
+
+[[noreturn]] static void throw_errno(char const* what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+checkpoint_writer::checkpoint_writer(std::string const& path) :
+_file(std::fopen(path.c_str(), "wb"), std::fclose) {
+	if (!_file)
+		throw_errno("fopen");
+
+	_write(magic, sizeof(magic));
+	_write(&version, sizeof(version));
+}
+
+void checkpoint_writer::write(std::span<std::byte const> const bytes) {
+	UInt const size = bytes.size();
+	_align();
+	_write(&size, sizeof(size));
+	_align();
+	_write(bytes.data(), size);
+	_sections++;
+}
+
+void checkpoint_writer::close() {
+	_align();
+	if (std::fflush(_file.get()) != 0)
+		throw_errno("fflush");
+}
+
+void checkpoint_writer::_write(void const* const data, Int const bytes) {
+	if (std::fwrite(data, 1, bytes, _file.get()) != static_cast<UInt>(bytes))
+		throw_errno("fwrite");
+	_size += bytes;
+}
+
+void checkpoint_writer::_align() {
+	static char const zeros[checkpoint_alignment] = {};
+	_write(zeros, (checkpoint_alignment - _size % checkpoint_alignment) % checkpoint_alignment);
+}
+
+checkpoint_reader::checkpoint_reader(std::string const& path) {
+	int const fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw_errno("open");
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int const error = errno;
+		::close(fd);
+		throw std::system_error(error, std::generic_category(), "fstat");
+	}
+	_size = st.st_size;
+
+	if (_size > 0) {
+		void* const data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		int const error  = errno;
+		::close(fd);
+		if (data == MAP_FAILED)
+			throw std::system_error(error, std::generic_category(), "mmap");
+		_data = static_cast<std::byte const*>(data);
+	} else
+		::close(fd);
+
+	UInt32 v = 0;
+	if (_size >= checkpoint_alignment)
+		std::memcpy(&v, _data + sizeof(magic), sizeof(v));
+	if (_size < checkpoint_alignment || std::memcmp(_data, magic, sizeof(magic)) != 0 ||
+	    v != version)
+		_fail("checkpoint_reader: not a checkpoint file");
+
+	// Only the headers are read, the sections themselves are paged in once accessed
+	for (Int pos = checkpoint_alignment; pos < _size;) {
+		UInt size = 0;
+		if (_size - pos < checkpoint_alignment)
+			_fail("checkpoint_reader: truncated file");
+		std::memcpy(&size, _data + pos, sizeof(size));
+		pos += checkpoint_alignment;
+		if (size > static_cast<UInt>(_size - pos))
+			_fail("checkpoint_reader: truncated file");
+		_sections.push_back({_data + pos, size});
+		pos += (size + checkpoint_alignment - 1) / checkpoint_alignment * checkpoint_alignment;
+	}
+}
+
+checkpoint_reader::~checkpoint_reader() {
+	if (_data)
+		munmap(const_cast<std::byte*>(_data), _size);
+}
+
+void checkpoint_reader::seek(Int const section) {
+	SPICE_PRE(0 <= section && section <= sections());
+	_next = section;
+}
+
+std::span<std::byte const> checkpoint_reader::_section() {
+	if (_next >= sections())
+		_mismatch();
+	return _sections[_next++];
+}
+
+void checkpoint_reader::_fail(char const* what) {
+	if (_data)
+		munmap(const_cast<std::byte*>(_data), _size);
+	throw std::runtime_error(what);
+}
+
+void checkpoint_reader::_mismatch() {
+	throw std::runtime_error("checkpoint_reader: unexpected section");
+}
\ No newline at end of file
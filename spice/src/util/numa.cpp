@@ -0,0 +1,148 @@
+#include "spice/util/numa.h"
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "spice/util/assert.h"
+#include "spice/util/range.h"
+
+using namespace spice;
+using namespace spice::util;
+
+// Supports up to 1024 nodes
+using node_mask                = std::array<unsigned long, 16>;
+static constexpr UInt max_node = 64 * std::tuple_size_v<node_mask>;
+
+static UInt page_size() {
+	static UInt const size = sysconf(_SC_PAGESIZE);
+	return size;
+}
+
+static UInt page_floor(UInt const addr) { return addr & ~(page_size() - 1); }
+static UInt page_ceil(UInt const addr) { return page_floor(addr + page_size() - 1); }
+
+static void mbind(UInt const first, UInt const last, int const mode, node_mask const* mask) {
+	if (first < last)
+		syscall(SYS_mbind, first, last - first, mode, mask ? mask->data() : nullptr,
+		        mask ? max_node : 0, MPOL_MF_MOVE);
+}
+
+Int util::numa_node_count() {
+	static Int const count = [] {
+		node_mask mask{};
+		if (syscall(SYS_get_mempolicy, nullptr, mask.data(), max_node, nullptr,
+		            MPOL_F_MEMS_ALLOWED) != 0)
+			return Int(1);
+
+		Int result = 1;
+		for (Int const node : util::range(max_node))
+			if (mask[node / 64] >> (node % 64) & 1)
+				result = node + 1;
+		return result;
+	}();
+	return count;
+}
+
+void util::numa_place(void const* data, Int const bytes, numa_policy const policy) {
+	SPICE_PRE(bytes >= 0);
+
+	UInt const first = page_floor(reinterpret_cast<UInt>(data));
+	UInt const last  = page_ceil(reinterpret_cast<UInt>(data) + bytes);
+	Int const nodes  = numa_node_count();
+
+	switch (policy) {
+		case numa_policy::local: mbind(first, last, MPOL_DEFAULT, nullptr); break;
+
+		case numa_policy::interleave: {
+			node_mask mask{};
+			for (Int const node : util::range(nodes))
+				mask[node / 64] |= 1ul << (node % 64);
+			mbind(first, last, MPOL_INTERLEAVE, &mask);
+		} break;
+
+		case numa_policy::partition: {
+			UInt const pages = (last - first) / page_size();
+			for (Int const node : util::range(nodes)) {
+				node_mask mask{};
+				mask[node / 64] |= 1ul << (node % 64);
+				mbind(first + node * pages / nodes * page_size(),
+				      first + (node + 1) * pages / nodes * page_size(), MPOL_PREFERRED, &mask);
+			}
+		} break;
+	}
+}
+
+std::vector<Int> util::numa_pages(void const* data, Int const bytes) {
+	SPICE_PRE(bytes >= 0);
+
+	UInt const first = page_floor(reinterpret_cast<UInt>(data));
+	UInt const last  = page_ceil(reinterpret_cast<UInt>(data) + bytes);
+
+	std::vector<void*> pages;
+	for (UInt page = first; page < last; page += page_size())
+		pages.push_back(reinterpret_cast<void*>(page));
+	std::vector<int> status(pages.size());
+
+	std::vector<Int> result(numa_node_count());
+	if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) == 0)
+		for (int const node : status)
+			if (0 <= node && node < result.size())
+				result[node]++;
+
+	return result;
+}
+
+std::vector<Int> util::numa_cpus(Int const node) {
+	SPICE_PRE(0 <= node && node < numa_node_count());
+
+	std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+	std::string list;
+	std::getline(file, list);
+	return parse_cpulist(list);
+}
+
+std::vector<Int> util::parse_cpulist(std::string const& list) {
+	std::vector<Int> result;
+	std::istringstream in(list);
+	for (std::string range; std::getline(in, range, ',');) {
+		range.erase(range.find_last_not_of(" \t\n") + 1);
+		range.erase(0, range.find_first_not_of(" \t\n"));
+
+		// "lo" or "lo-hi"
+		char const* const end = range.data() + range.size();
+		Int lo                = 0;
+		auto r                = std::from_chars(range.data(), end, lo);
+		Int hi                = lo;
+		if (r.ec == std::errc() && r.ptr != end && *r.ptr == '-')
+			r = std::from_chars(r.ptr + 1, end, hi);
+		if (r.ec != std::errc() || r.ptr != end || lo < 0)
+			continue;
+
+		for (Int const cpu : util::range(lo, hi + 1))
+			result.push_back(cpu);
+	}
+	return result;
+}
+
+void util::numa_pin(pthread_t const thread, Int const node) {
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	bool any = false;
+	for (Int const cpu : numa_cpus(node))
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &cpus);
+			any = true;
+		}
+
+	if (any)
+		pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+}
@@ -0,0 +1,78 @@
+#include "spice/util/task_graph.h"
+
+#include <algorithm>
+
+#include "spice/util/assert.h"
+
+using namespace spice::util;
+
+Int task_graph::add() {
+	_successors.emplace_back();
+	_predecessor_counts.push_back(0);
+	return size() - 1;
+}
+
+void task_graph::precede(Int const first, Int const then) {
+	SPICE_PRE(0 <= first && first < size());
+	SPICE_PRE(0 <= then && then < size());
+	SPICE_PRE(first != then);
+
+	auto& succ = _successors[first];
+	if (std::find(succ.begin(), succ.end(), then) == succ.end()) {
+		succ.push_back(then);
+		_predecessor_counts[then]++;
+	}
+}
+
+Int task_graph::size() const { return _successors.size(); }
+
+std::vector<Int> const& task_graph::successors(Int const task) const {
+	SPICE_PRE(0 <= task && task < size());
+	return _successors[task];
+}
+
+Int task_graph::predecessor_count(Int const task) const {
+	SPICE_PRE(0 <= task && task < size());
+	return _predecessor_counts[task];
+}
+
+void task_graph::_run(thread_pool& pool, void (*invoke)(void*, Int), void* fn) const {
+	struct context {
+		task_graph const* graph;
+		thread_pool* pool;
+		void (*invoke)(void*, Int);
+		void* fn;
+		std::unique_ptr<std::atomic<Int>[]> pending;
+		thread_pool::job j;
+
+		static void run(void* c, Int const task) {
+			auto& ctx = *static_cast<context*>(c);
+			ctx.j.run([&] {
+				struct release_successors {
+					context& ctx;
+					Int task;
+					~release_successors() {
+						for (Int const succ : ctx.graph->_successors[task])
+							if (ctx.pending[succ].fetch_sub(1, std::memory_order_acq_rel) == 1)
+								ctx.pool->spawn({run, &ctx, succ});
+					}
+				} _{ctx, task};
+
+				ctx.invoke(ctx.fn, task);
+			});
+		}
+	} ctx{this, &pool, invoke, fn, std::make_unique<std::atomic<Int>[]>(size()), {size()}};
+
+	if (size() == 0)
+		return;
+
+	for (Int i = 0; i < size(); i++)
+		ctx.pending[i].store(_predecessor_counts[i], std::memory_order_relaxed);
+
+	// Spawn in reverse so that roots are processed in order by the calling thread.
+	for (Int i = size() - 1; i >= 0; i--)
+		if (_predecessor_counts[i] == 0)
+			pool.spawn({context::run, &ctx, i});
+
+	ctx.j.wait(pool);
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "spice/util/thread_pool.h"
+
+#include "spice/util/assert.h"
+#include "spice/util/numa.h"
+
+using namespace spice::util;
+
+// The pool and queue the current thread belongs to (if any)
+static thread_local thread_pool const* t_pool = nullptr;
+static thread_local Int t_id                  = 0;
+
+thread_pool::thread_pool(Int const nthreads) : _queues(new queue[nthreads]) {
+	SPICE_PRE(nthreads >= 1);
+
+	for (Int i = 1; i < nthreads; i++)
+		_workers.emplace_back([this, i] { _work(i); });
+}
+
+thread_pool::~thread_pool() {
+	{
+		std::lock_guard _(_sleep_mtx);
+		_stop = true;
+	}
+	_cv.notify_all();
+
+	for (auto& w : _workers)
+		w.join();
+}
+
+Int thread_pool::size() const { return _workers.size() + 1; }
+
+void thread_pool::pin_to_numa_nodes() {
+	std::vector<Int> nodes;
+	for (Int node = 0; node < numa_node_count(); node++)
+		if (!numa_cpus(node).empty())
+			nodes.push_back(node);
+
+	for (Int i = 1; i < size() && !nodes.empty(); i++)
+		numa_pin(_workers[i - 1].native_handle(), nodes[i * nodes.size() / size()]);
+}
+
+void thread_pool::spawn(task const t) {
+	_push(t, _id());
+	_notify();
+}
+
+void thread_pool::wait(std::atomic<Int> const& remaining) {
+	Int const id = _id();
+	while (remaining.load(std::memory_order_acquire) > 0)
+		if (!_run_one(id))
+			std::this_thread::yield();
+}
+
+Int thread_pool::_id() const { return t_pool == this ? t_id : 0; }
+
+void thread_pool::_push(task const t, Int const q) {
+	SPICE_INV(0 <= q && q < size());
+
+	{
+		std::lock_guard _(_queues[q].mtx);
+		_queues[q].tasks.push_back(t);
+	}
+	_queued.fetch_add(1, std::memory_order_release);
+}
+
+void thread_pool::_notify() {
+	if (_workers.empty())
+		return;
+
+	// Acquiring the mutex prevents lost wake-ups between a worker checking _queued and going to
+	// sleep.
+	{ std::lock_guard _(_sleep_mtx); }
+	_cv.notify_all();
+}
+
+bool thread_pool::_run_one(Int const id) {
+	if (_queued.load(std::memory_order_acquire) == 0)
+		return false;
+
+	for (Int i = 0; i < size(); i++) {
+		Int const victim = (id + i) % size();
+		task t;
+		{
+			std::lock_guard _(_queues[victim].mtx);
+			auto& tasks = _queues[victim].tasks;
+			if (tasks.empty())
+				continue;
+
+			// Process own tasks in LIFO order, steal in FIFO order
+			if (i == 0) {
+				t = tasks.back();
+				tasks.pop_back();
+			} else {
+				t = tasks.front();
+				tasks.pop_front();
+			}
+		}
+		_queued.fetch_sub(1, std::memory_order_relaxed);
+
+		t.invoke(t.ctx, t.arg);
+		return true;
+	}
+
+	return false;
+}
+
+void thread_pool::_work(Int const id) {
+	t_pool = this;
+	t_id   = id;
+
+	for (;;) {
+		// Spin briefly before going to sleep since work usually arrives in quick succession
+		// (once per simulation step or phase).
+		for (Int spin = 0; spin < 1000; spin++) {
+			if (_run_one(id))
+				spin = 0;
+			else
+				std::this_thread::yield();
+		}
+
+		std::unique_lock lock(_sleep_mtx);
+		_cv.wait(lock, [&] { return _stop || _queued.load(std::memory_order_acquire) > 0; });
+		if (_stop)
+			return;
+	}
+}
\ No newline at end of file
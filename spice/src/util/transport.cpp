@@ -0,0 +1,173 @@
+#include "spice/util/transport.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <system_error>
+
+#include "spice/util/assert.h"
+#include "spice/util/range.h"
+
+using namespace spice;
+using namespace spice::util;
+
+[[noreturn]] static void throw_errno(char const* what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+void transport::all_gather(std::span<std::byte const> send,
+                           std::vector<std::vector<std::byte>>& recv) {
+	auto const start = std::chrono::steady_clock::now();
+
+	recv.resize(size());
+	_all_gather(send, recv);
+
+	_stats.exchanges++;
+	for (Int r : util::range(size()))
+		if (r != rank())
+			_stats.bytes += send.size() + recv[r].size();
+	_stats.seconds +=
+	    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::unique_ptr<socket_transport> socket_transport::fork(Int const ranks) {
+	SPICE_PRE(ranks >= 1);
+
+	// sockets[i][j]: rank i's end of the connection between ranks i and j
+	std::vector<std::vector<int>> sockets(ranks, std::vector<int>(ranks, -1));
+	for (Int i : util::range(ranks))
+		for (Int j : util::range(i + 1, ranks)) {
+			int pair[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+				throw_errno("socketpair");
+			sockets[i][j] = pair[0];
+			sockets[j][i] = pair[1];
+		}
+
+	auto const keep = [&](Int const rank) {
+		for (Int i : util::range(ranks))
+			if (i != rank)
+				for (int const s : sockets[i])
+					if (s >= 0)
+						close(s);
+
+		for (int const s : sockets[rank])
+			if (s >= 0 && fcntl(s, F_SETFL, O_NONBLOCK) != 0)
+				throw_errno("fcntl");
+		return sockets[rank];
+	};
+
+	std::vector<pid_t> children;
+	for (Int rank : util::range(1, ranks)) {
+		pid_t const pid = ::fork();
+		if (pid < 0)
+			throw_errno("fork");
+
+		if (pid == 0)
+			return std::unique_ptr<socket_transport>(new socket_transport(rank, keep(rank), {}));
+
+		children.push_back(pid);
+	}
+
+	return std::unique_ptr<socket_transport>(new socket_transport(0, keep(0), children));
+}
+
+socket_transport::socket_transport(Int const rank, std::vector<int> peers,
+                                   std::vector<pid_t> children) :
+_rank(rank), _peers(std::move(peers)), _children(std::move(children)) {}
+
+socket_transport::~socket_transport() {
+	for (int const s : _peers)
+		if (s >= 0)
+			close(s);
+
+	for (pid_t const child : _children)
+		waitpid(child, nullptr, 0);
+}
+
+Int socket_transport::rank() const { return _rank; }
+Int socket_transport::size() const { return _peers.size(); }
+
+// Sends 'send' to all peers and receives from all peers at the same time (to avoid deadlocks
+// once the sockets' buffers fill up). Every message is prefixed by its size.
+void socket_transport::_all_gather(std::span<std::byte const> send,
+                                   std::vector<std::vector<std::byte>>& recv) {
+	struct channel {
+		Int sent       = 0; // including the size prefix
+		Int received   = 0; // including the size prefix
+		UInt recv_size = 0;
+	};
+	UInt const send_size = send.size();
+	Int const prefix     = sizeof(UInt);
+
+	recv[_rank].assign(send.begin(), send.end());
+
+	std::vector<channel> channels(size());
+	std::vector<pollfd> fds;
+	for (;;) {
+		fds.clear();
+		for (Int peer : util::range(size())) {
+			if (peer == _rank)
+				continue;
+
+			auto& c      = channels[peer];
+			short events = 0;
+			if (c.sent < prefix + Int(send_size))
+				events |= POLLOUT;
+			if (c.received < prefix || c.received < prefix + Int(c.recv_size))
+				events |= POLLIN;
+			if (events)
+				fds.push_back({_peers[peer], events, 0});
+		}
+		if (fds.empty())
+			break;
+
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			throw_errno("poll");
+		}
+
+		for (auto const& fd : fds) {
+			Int const peer = std::find(_peers.begin(), _peers.end(), fd.fd) - _peers.begin();
+			auto& c        = channels[peer];
+
+			if (fd.revents & POLLOUT) {
+				ssize_t const n =
+				    c.sent < prefix
+				        ? ::send(fd.fd, reinterpret_cast<std::byte const*>(&send_size) + c.sent,
+				                 prefix - c.sent, MSG_NOSIGNAL)
+				        : ::send(fd.fd, send.data() + (c.sent - prefix),
+				                 send_size - (c.sent - prefix), MSG_NOSIGNAL);
+				if (n < 0 && errno != EAGAIN)
+					throw_errno("send");
+				c.sent += std::max<ssize_t>(n, 0);
+			}
+
+			if (fd.revents & (POLLIN | POLLHUP | POLLERR)) {
+				ssize_t n = 0;
+				if (c.received < prefix)
+					n = ::recv(fd.fd, reinterpret_cast<std::byte*>(&c.recv_size) + c.received,
+					           prefix - c.received, 0);
+				else
+					n = ::recv(fd.fd, recv[peer].data() + (c.received - prefix),
+					           c.recv_size - (c.received - prefix), 0);
+				if (n == 0)
+					throw std::runtime_error("socket_transport: peer disconnected");
+				if (n < 0 && errno != EAGAIN)
+					throw_errno("recv");
+				c.received += std::max<ssize_t>(n, 0);
+
+				if (c.received == prefix)
+					recv[peer].resize(c.recv_size);
+			}
+		}
+	}
+}
@@ -1,11 +1,17 @@
 #include "gtest/gtest.h"
 
 #include <concepts>
+#include <initializer_list>
+#include <utility>
+#include <vector>
 
 #include "spice/detail/csr.h"
 
 using namespace spice;
 using namespace spice::detail;
+using namespace spice::util;
+
+static thread_pool pool;
 
 TEST(CSR, Iterator) {
 	static_assert(std::input_iterator<csr<>::iterator>);
@@ -17,7 +23,7 @@ TEST(CSR, Iterator) {
 TEST(CSR, Empty) {
 	adj_list adj;
 	adj(1, 0);
-	csr c(adj, {1337});
+	csr c(adj, {1337}, pool);
 
 	ASSERT_EQ(c.neighbors(0).size(), 0);
 }
@@ -35,7 +41,7 @@ TEST(CSR, Custom) {
 	adj.connect(2, 2);
 	adj(3, 10);
 
-	csr c(adj, {1337});
+	csr c(adj, {1337}, pool);
 
 	ASSERT_EQ(c.neighbors(0).size(), 4);
 	ASSERT_EQ(c.neighbors(1).size(), 0);
@@ -62,8 +68,197 @@ TEST(CSR, Payload) {
 	adj_list adj;
 	adj.connect(0, 0);
 	adj(1, 1);
-	csr<int> c(adj, {1337});
+	csr<int> c(adj, {1337}, pool);
 
 	std::vector<std::pair<Int32, int*>> neighbors(c.neighbors(0).begin(), c.neighbors(0).end());
 	ASSERT_EQ(neighbors.size(), 1);
+}
+
+TEST(CSR, Partition) {
+	fixed_probability fprob(0.2);
+	csr<int> c(fprob(50, 1000), {1337}, pool);
+
+	for (Int parts : {1, 3, 8, 1000, 2000}) {
+		c.partition(parts);
+		ASSERT_EQ(c.parts(), parts);
+
+		for (Int src : range(50)) {
+			std::vector<std::pair<Int32, int*>> expected(c.neighbors(src).begin(),
+			                                             c.neighbors(src).end());
+			std::vector<std::pair<Int32, int*>> actual;
+			for (Int part : range(parts)) {
+				for (auto edge : c.neighbors(src, part)) {
+					ASSERT_GE(edge.first, part * 1000 / parts);
+					ASSERT_LT(edge.first, (part + 1) * 1000 / parts);
+					actual.push_back(edge);
+				}
+			}
+
+			ASSERT_EQ(actual, expected);
+		}
+	}
+}
+
+// Neighbors are stored as UInt16 iff there are at most 2^16 destinations
+TEST(CSR, NarrowIndices) {
+	for (Int dst_count : {65536, 65537}) {
+		adj_list adj;
+		adj.connect(0, 0);
+		adj.connect(0, dst_count - 1);
+		adj.connect(2, 1);
+		adj.connect(2, dst_count / 2);
+		adj(3, dst_count);
+		csr<int> c(adj, {1337}, pool);
+
+		std::vector<Int32> neighbors;
+		for (Int src : range(3))
+			for (auto edge : c.neighbors(src))
+				neighbors.push_back(edge.first);
+		ASSERT_EQ(neighbors,
+		          (std::vector<Int32>{0, Int32(dst_count - 1), 1, Int32(dst_count / 2)}));
+
+		// 4 offsets, 4 neighbors
+		auto const mem = c.memory();
+		ASSERT_EQ(mem.wide_bytes, 4 * 8 + 4 * 4);
+		ASSERT_EQ(mem.bytes, 4 * 4 + 4 * (dst_count <= 65536 ? 2 : 4));
+
+		c.filter_destinations(1, dst_count);
+		neighbors.clear();
+		for (Int src : range(3))
+			for (auto edge : c.neighbors(src))
+				neighbors.push_back(edge.first);
+		ASSERT_EQ(neighbors, (std::vector<Int32>{Int32(dst_count - 1), 1, Int32(dst_count / 2)}));
+	}
+}
+
+// Generating a slice of the destinations equals filtering the whole graph
+TEST(CSR, Slice) {
+	adj_list adj;
+	for (Int i : range(20'000))
+		adj.connect((i * 7919) % 100, (i * 104729) % 70'000);
+	fixed_probability narrow(0.1), wide(0.1);
+
+	for (Topology* c : std::initializer_list<Topology*>{&adj(100, 70'000), &narrow(100, 2000),
+	                                                    &wide(100, 70'000)})
+		for (auto [first, last] : {std::pair(0, 0), std::pair(0, 700), std::pair(700, 1400)}) {
+			csr<> expected(*c, {1337}, pool, 2.0);
+			expected.filter_destinations(first, last);
+			csr<> actual(*c, first, last, {1337}, pool);
+
+			for (Int src : range(100)) {
+				std::vector<Int32> a, b;
+				for (auto edge : actual.neighbors(src))
+					a.push_back(edge.first);
+				for (auto edge : expected.neighbors(src))
+					b.push_back(edge.first);
+				ASSERT_EQ(a, b) << src;
+			}
+			ASSERT_EQ(actual.memory().bytes, expected.memory().bytes);
+		}
+}
+
+TEST(CSR, Relabel) {
+	adj_list adj;
+	adj.connect(0, 1);
+	adj.connect(0, 2);
+	adj.connect(0, 4);
+	adj.connect(1, 0);
+	adj.connect(1, 3);
+	adj(2, 5);
+
+	// As lists and as bitsets
+	for (double dense_density : {2.0, 0.0}) {
+		csr<Int> c(adj, {1337}, pool, dense_density);
+		for (Int src : range(2))
+			for (auto edge : c.neighbors(src))
+				*edge.second = src * 10 + edge.first;
+
+		std::vector<bool> seen(5);
+		std::vector<Int32> order;
+		c.first_touch(order, seen);
+		ASSERT_EQ(order, (std::vector<Int32>{1, 2, 4, 0, 3}));
+
+		// Reverse all destinations
+		std::vector<Int32> const index{4, 3, 2, 1, 0};
+		c.relabel_destinations(index, pool);
+
+		std::vector<std::pair<Int32, Int>> row0, row1;
+		for (auto edge : c.neighbors(0))
+			row0.push_back({edge.first, *edge.second});
+		for (auto edge : c.neighbors(1))
+			row1.push_back({edge.first, *edge.second});
+		ASSERT_EQ(row0, (std::vector<std::pair<Int32, Int>>{{0, 4}, {2, 2}, {3, 1}}));
+		ASSERT_EQ(row1, (std::vector<std::pair<Int32, Int>>{{1, 13}, {4, 10}}));
+	}
+}
+
+// Dense graphs store their rows as bitsets, which behave exactly like lists
+TEST(CSR, Dense) {
+	fixed_probability fprob(0.5);
+	auto& topology = fprob(40, 1000);
+	csr<int> lists(topology, {1337}, pool, 2.0);
+	csr<int> bitsets(topology, {1337}, pool);
+
+	// (neighbor, index of the edge's payload) of all rows
+	auto const rows = [](csr<int>& c, Int const part) {
+		int const* const edges = (*c.neighbors(0).begin()).second;
+		std::vector<std::vector<std::pair<Int32, Int>>> result;
+		for (Int src : range(40)) {
+			result.emplace_back();
+			for (auto edge : part < 0 ? c.neighbors(src) : c.neighbors(src, part))
+				result.back().push_back({edge.first, edge.second - edges});
+		}
+		return result;
+	};
+
+	ASSERT_EQ(rows(bitsets, -1), rows(lists, -1));
+	ASSERT_LT(bitsets.memory().bytes, lists.memory().bytes / 4);
+	ASSERT_EQ(bitsets.memory().wide_bytes, lists.memory().wide_bytes);
+
+	for (Int parts : {3, 64, 1000}) {
+		bitsets.partition(parts);
+		lists.partition(parts);
+		for (Int part : range(parts))
+			ASSERT_EQ(rows(bitsets, part), rows(lists, part)) << parts << " parts";
+	}
+
+	bitsets.filter_destinations(130, 900);
+	lists.filter_destinations(130, 900);
+	ASSERT_EQ(rows(bitsets, -1), rows(lists, -1));
+
+	// Duplicate edges
+	adj_list adj;
+	adj.connect(0, 1);
+	adj.connect(0, 1);
+	adj(1, 2);
+	csr<> c(adj, {1337}, pool);
+	ASSERT_EQ(c.neighbors(0).size(), 2);
+}
+
+TEST(CSR, Shared) {
+	adj_list adj;
+	adj.connect(0, 1);
+	adj.connect(0, 3);
+	adj.connect(1, 2);
+	adj(2, 4);
+
+	csr<> a(adj, {1337}, pool);
+	csr<int> b(a.structure());
+	ASSERT_EQ(a.structure(), b.structure());
+
+	auto const row = [](auto& c, Int const src) {
+		std::vector<Int32> result;
+		for (auto edge : c.neighbors(src))
+			result.push_back(edge.first);
+		return result;
+	};
+	ASSERT_EQ(row(b, 0), (std::vector<Int32>{1, 3}));
+	ASSERT_EQ(row(b, 1), (std::vector<Int32>{2}));
+
+	// Modifications copy the structure first
+	b.filter_destinations(2, 4);
+	ASSERT_NE(a.structure(), b.structure());
+	ASSERT_EQ(row(a, 0), (std::vector<Int32>{1, 3}));
+	ASSERT_EQ(row(b, 0), (std::vector<Int32>{3}));
+	ASSERT_EQ(a.memory(false).bytes, 0);
 }
\ No newline at end of file
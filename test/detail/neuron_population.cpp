@@ -1,5 +1,8 @@
 #include "gtest/gtest.h"
 
+#include <string>
+#include <vector>
+
 #include "spice/detail/neuron_population.h"
 
 using namespace spice;
@@ -15,22 +18,47 @@ static_assert(StatelessNeuron<stateless_neuron>);
 
 TEST(NeuronPopulation, Stateless) {
 	seed_seq seed{1337};
-	xoroshiro64_128p rng(seed);
+	thread_pool pool;
 	neuron_population<stateless_neuron> pop({}, 5, seed, 2);
 	pop.plastic();
 
 	ASSERT_EQ(pop.size(), 5);
 
 	stateless_neuron::fire = false;
-	pop.update(2, 1, rng);
+	pop.update(1, seed, pool);
 	ASSERT_EQ(pop.spikes(0).size(), 0);
 
 	stateless_neuron::fire = true;
-	pop.update(2, 1, rng);
+	pop.update(1, seed, pool);
 	ASSERT_EQ(pop.spikes(0).size(), 5);
 	for (Int i : range(5)) {
 		ASSERT_EQ(pop.spikes(0)[i], i);
-		ASSERT_EQ(pop.history()[i], 1);
+		ASSERT_EQ(history_at(pop.history()[i], 1), 1);
+	}
+}
+
+struct random_neuron {
+	bool update(float, auto& rng) const { return generate_canonical<float>(rng) < 0.5f; }
+};
+static_assert(StatelessNeuron<random_neuron>);
+
+// Every neuron draws from its own stream, independently of blocks and threads
+TEST(NeuronPopulation, RandomStreams) {
+	seed_seq seed{1337};
+	Int const size = 3 * block_size + 5;
+
+	std::vector<Int32> expected;
+	for (Int i : range(size)) {
+		philox4x32_10 rng(seed, i);
+		if (generate_canonical<float>(rng) < 0.5f)
+			expected.push_back(i);
+	}
+
+	for (Int threads : {1, 3}) {
+		thread_pool pool(threads);
+		neuron_population<random_neuron> pop({}, size, seed, 1);
+		pop.update(1, seed, pool);
+		ASSERT_EQ(std::vector<Int32>(pop.spikes(0).begin(), pop.spikes(0).end()), expected);
 	}
 }
 
@@ -49,7 +77,7 @@ static_assert(StatefulNeuron<stateful_neuron>);
 
 TEST(NeuronPopulation, Stateful) {
 	seed_seq seed{1337};
-	xoroshiro64_128p rng(seed);
+	thread_pool pool;
 	neuron_population<stateful_neuron> pop({}, 5, seed, 1);
 	pop.plastic();
 
@@ -57,7 +85,7 @@ TEST(NeuronPopulation, Stateful) {
 	for (auto& n : pop.get_neurons())
 		ASSERT_FALSE(n.fired);
 
-	pop.update(1, 1, rng);
+	pop.update(1, seed, pool);
 
 	for (auto& n : pop.get_neurons())
 		ASSERT_TRUE(n.fired);
@@ -72,7 +100,7 @@ static_assert(PerNeuronInit<per_neuron_init>);
 
 TEST(NeuronPopulation, PerNeuronInit) {
 	seed_seq seed{1337};
-	xoroshiro64_128p rng(seed);
+	thread_pool pool;
 	neuron_population<per_neuron_init> pop({}, 5, seed, 1);
 	pop.plastic();
 
@@ -80,7 +108,7 @@ TEST(NeuronPopulation, PerNeuronInit) {
 	for (auto& n : pop.get_neurons())
 		ASSERT_FALSE(n.fired);
 
-	pop.update(1, 1, rng);
+	pop.update(1, seed, pool);
 
 	for (auto& n : pop.get_neurons())
 		ASSERT_TRUE(n.fired);
@@ -96,7 +124,7 @@ TEST(NeuronPopulation, PerNeuronInit) {
 	}
 
 	for (Int i : range(5))
-		ASSERT_EQ(pop.history()[i], i % 2);
+		ASSERT_EQ(history_at(pop.history()[i], 0), i % 2);
 }
 
 struct per_population_init : public stateful_neuron {
@@ -109,7 +137,7 @@ static_assert(PerPopulationInit<per_population_init>);
 
 TEST(NeuronPopulation, PerPopulationInit) {
 	seed_seq seed{1337};
-	xoroshiro64_128p rng(seed);
+	thread_pool pool;
 	neuron_population<per_population_init> pop({}, 5, seed, 1);
 	pop.plastic();
 
@@ -117,7 +145,7 @@ TEST(NeuronPopulation, PerPopulationInit) {
 	for (auto& n : pop.get_neurons())
 		ASSERT_FALSE(n.fired);
 
-	pop.update(1, 1, rng);
+	pop.update(1, seed, pool);
 
 	for (auto& n : pop.get_neurons())
 		ASSERT_TRUE(n.fired);
@@ -133,7 +161,113 @@ TEST(NeuronPopulation, PerPopulationInit) {
 	}
 
 	for (Int i : range(5))
-		ASSERT_EQ(pop.history()[i], i % 2);
+		ASSERT_EQ(history_at(pop.history()[i], 0), i % 2);
+}
+
+struct soa_neuron {
+	struct neuron {
+		bool fired = false;
+		Int id     = 0;
+	};
+
+	void init(neuron& n, Int id, auto&) const { n.id = id; }
+	bool update(neuron& n, float, auto&) const {
+		n.fired = true;
+		return n.id % 2;
+	}
+};
+BOOST_HANA_ADAPT_STRUCT(soa_neuron::neuron, fired, id);
+static_assert(SoANeuron<soa_neuron>);
+
+TEST(NeuronPopulation, SoA) {
+	seed_seq seed{1337};
+	thread_pool pool(2);
+	Int const size = 2 * block_size + 3;
+	neuron_population<soa_neuron> pop({}, size, seed, 1);
+
+	auto& neurons = pop.get_neurons();
+	ASSERT_EQ(neurons.size(), size);
+	for (Int i : range(size)) {
+		ASSERT_FALSE(neurons.load(i).fired);
+		ASSERT_EQ(neurons.load(i).id, i);
+	}
+
+	pop.update(1, seed, pool);
+
+	for (bool fired : neurons.field<0>())
+		ASSERT_TRUE(fired);
+
+	ASSERT_EQ(pop.spikes(0).size(), size / 2);
+	for (Int i : range(pop.spikes(0)))
+		ASSERT_EQ(pop.spikes(0)[i], 2 * i + 1);
+
+	std::vector<std::string> buffers;
+	for (auto const& p : pop.placement())
+		buffers.push_back(p.buffer);
+	ASSERT_EQ(buffers, (std::vector<std::string>{"neurons.fired", "neurons.id", "history"}));
+}
+
+// Fires every 'period' steps, where a neuron's period is derived from its index
+template <bool Batch>
+struct counter_neuron {
+	struct neuron {
+		Int32 count  = 0;
+		Int32 period = 0;
+	};
+	struct batch {
+		simd<Int32> count;
+		simd<Int32> period;
+	};
+
+	void init(neuron& n, Int id, auto&) const { n.period = 1 + id % 5; }
+
+	bool update(neuron& n, float, auto&) const requires(!Batch) {
+		bool const spiked = ++n.count >= n.period;
+		n.count           = spiked ? 0 : n.count;
+		return spiked;
+	}
+	UInt32 update(batch& b, float, auto&) const requires(Batch) {
+		auto const spiked = ++b.count >= b.period;
+		b.count           = spiked ? 0 : b.count;
+		return to_bitmask(spiked);
+	}
+};
+BOOST_HANA_ADAPT_STRUCT(counter_neuron<false>::neuron, count, period);
+BOOST_HANA_ADAPT_STRUCT(counter_neuron<true>::neuron, count, period);
+BOOST_HANA_ADAPT_STRUCT(counter_neuron<true>::batch, count, period);
+static_assert(CheckNeuron<counter_neuron<true>>());
+static_assert(PerBatchUpdate<counter_neuron<true>> && !PerBatchUpdate<counter_neuron<false>>);
+
+// Batches produce the same spikes as per-neuron updates, including partial batches at the
+// ends of blocks and owned ranges.
+TEST(NeuronPopulation, PerBatchUpdate) {
+	seed_seq seed{1337};
+	Int const size = 2 * block_size + 13;
+
+	thread_pool pool(3);
+	neuron_population<counter_neuron<false>> expected({}, size, seed, 1);
+	neuron_population<counter_neuron<true>> actual({}, size, seed, 1);
+	neuron_population<counter_neuron<true>> owned({}, size, seed, 1);
+	ASSERT_TRUE(owned.own(5, size - 3));
+
+	for (Int step : range(10)) {
+		expected.update(1, seed, pool);
+		actual.update(1, seed, pool);
+		owned.update(1, seed, pool);
+
+		auto const spikes = expected.spikes(0);
+		ASSERT_EQ(std::vector<Int32>(actual.spikes(0).begin(), actual.spikes(0).end()),
+		          std::vector<Int32>(spikes.begin(), spikes.end()))
+		    << step;
+
+		std::vector<Int32> owned_spikes;
+		for (Int32 s : spikes)
+			if (5 <= s && s < size - 3)
+				owned_spikes.push_back(s);
+		ASSERT_EQ(std::vector<Int32>(owned.spikes(0).begin(), owned.spikes(0).end()),
+		          owned_spikes)
+		    << step;
+	}
 }
 
 struct per_population_update {
@@ -145,26 +279,90 @@ static_assert(PerPopulationUpdate<per_population_update>);
 
 TEST(NeuronPopulation, PerPopulationUpdate) {
 	seed_seq seed{1337};
-	xoroshiro64_128p rng(seed);
+	thread_pool pool;
 	neuron_population<per_population_update> pop({}, 10, seed, 1);
 	pop.plastic();
 
 	ASSERT_EQ(pop.size(), 10);
 
-	pop.update(1, 1, rng);
+	pop.update(1, seed, pool);
 	ASSERT_EQ(pop.spikes(0).size(), 3);
 	ASSERT_EQ(pop.spikes(0)[0], 1);
 	ASSERT_EQ(pop.spikes(0)[1], 3);
 	ASSERT_EQ(pop.spikes(0)[2], 8);
 
-	ASSERT_EQ(pop.history()[0], 0);
-	ASSERT_EQ(pop.history()[1], 1);
-	ASSERT_EQ(pop.history()[2], 0);
-	ASSERT_EQ(pop.history()[3], 1);
-	ASSERT_EQ(pop.history()[4], 0);
-	ASSERT_EQ(pop.history()[5], 0);
-	ASSERT_EQ(pop.history()[6], 0);
-	ASSERT_EQ(pop.history()[7], 0);
-	ASSERT_EQ(pop.history()[8], 1);
-	ASSERT_EQ(pop.history()[9], 0);
+	ASSERT_EQ(history_at(pop.history()[0], 0), 0);
+	ASSERT_EQ(history_at(pop.history()[1], 0), 1);
+	ASSERT_EQ(history_at(pop.history()[2], 0), 0);
+	ASSERT_EQ(history_at(pop.history()[3], 0), 1);
+	ASSERT_EQ(history_at(pop.history()[4], 0), 0);
+	ASSERT_EQ(history_at(pop.history()[5], 0), 0);
+	ASSERT_EQ(history_at(pop.history()[6], 0), 0);
+	ASSERT_EQ(history_at(pop.history()[7], 0), 0);
+	ASSERT_EQ(history_at(pop.history()[8], 0), 1);
+	ASSERT_EQ(history_at(pop.history()[9], 0), 0);
+}
+
+// Emits 'step' spikes during step 'step' (neurons 0, 1, ...), so every step is recognizable
+struct counting_neuron {
+	Int32 step = 0;
+	void update(float, auto&, std::vector<Int32>& spikes) {
+		for (Int32 i = 0; i < step; i++)
+			spikes.push_back(i);
+		step++;
+	}
+};
+
+TEST(NeuronPopulation, SpikeRing) {
+	seed_seq seed{1337};
+	thread_pool pool;
+	Int const max_delay = 3;
+	neuron_population<counting_neuron> pop({}, 100, seed, max_delay);
+
+	for (Int step : range(50)) {
+		pop.update(1, seed, pool);
+		for (Int age : range(std::min(step + 1, max_delay))) {
+			ASSERT_EQ(pop.spikes(age).size(), step - age);
+			ASSERT_EQ(pop.spikes_at(step - age).data(), pop.spikes(age).data());
+		}
+	}
+
+	std::vector<Int32> const spikes{4, 2};
+	pop.set_spikes(48, spikes);
+	ASSERT_EQ(pop.spikes(1).size(), 2);
+	ASSERT_EQ(pop.spikes(1)[0], 4);
+	ASSERT_EQ(pop.spikes(0).size(), 49);
+
+#ifdef SPICE_ASSERT_PRECONDITIONS
+	// Slots are reused after 2 * max_delay steps
+	ASSERT_THROW(pop.spikes_at(50 - 2 * max_delay - 1), std::logic_error);
+#endif
+}
+
+// Neuron n spikes every n + 1 steps
+struct periodic_neuron {
+	Int32 step = 0;
+	void update(float, auto&, std::vector<Int32>& spikes) {
+		for (Int32 n = 0; n < 4; n++)
+			if (step % (n + 1) == 0)
+				spikes.push_back(n);
+		step++;
+	}
+};
+
+TEST(NeuronPopulation, History) {
+	seed_seq seed{1337};
+	thread_pool pool;
+	neuron_population<periodic_neuron> pop({}, 4, seed, 1);
+	pop.plastic();
+
+	// Well past 64 steps, so every bit gets reused
+	UInt expected[4] = {0};
+	for (Int step : range(200)) {
+		pop.update(1, seed, pool);
+		for (Int n : range(4)) {
+			expected[n] = (expected[n] << 1) | (step % (n + 1) == 0);
+			ASSERT_EQ(history_at(pop.history()[n], step), expected[n]);
+		}
+	}
 }
\ No newline at end of file
@@ -2,18 +2,48 @@
 
 #include "spice/detail/synapse_population.h"
 
+#include <bitset>
+#include <initializer_list>
+
 using namespace spice;
 using namespace spice::detail;
 using namespace spice::util;
 
+static thread_pool pool;
+
 struct stateless_neuron {
 	bool update(float, auto) const { return false; }
 };
 static_assert(StatelessNeuron<stateless_neuron>);
 
+// The steps (< 128) a plastic_synapse updated, with(out) pre- and postsynaptic activity, or skipped
+struct step_log {
+	std::bitset<128> updated, skipped, pre, post;
+
+	bool operator==(step_log const&) const = default;
+};
+
+static std::bitset<128> steps(std::initializer_list<Int> list) {
+	std::bitset<128> result;
+	for (Int step : list)
+		result.set(step);
+	return result;
+}
+
+static std::bitset<128> steps(Int const first, Int const last) {
+	std::bitset<128> result;
+	for (Int step : range(first, last))
+		result.set(step);
+	return result;
+}
+
+// Records a spike during 'step' in 'hist', at the bit neuron populations use (see history_at())
+static void spike(UInt& hist, Int const step) { hist |= 1_u64 << (63 - step % 64); }
+
 struct stateful_neuron {
 	struct neuron {
 		int received_count = 0;
+		step_log log; // Of the last plastic_synapse delivered
 	};
 
 	bool update(neuron& n, float, auto) const { return false; }
@@ -39,7 +69,7 @@ requires Synapse<Syn, stateless_neuron, stateful_neuron>
 	adj.connect(1, 3);
 	adj.connect(2, 4);
 
-	return synapse_population<Syn, stateless_neuron, stateful_neuron>({}, adj, seed, 1);
+	return synapse_population<Syn, stateless_neuron, stateful_neuron>({}, adj, seed, 1, pool);
 }
 
 TEST(SynapsePopulation, DeliverStateless) {
@@ -47,7 +77,7 @@ TEST(SynapsePopulation, DeliverStateless) {
 	Int32 spikes[] = {0, 1};
 	auto syn       = setup<stateless_synapse>();
 
-	syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, {});
+	syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, {}, pool);
 
 	ASSERT_EQ(neurons[0].received_count, 1);
 	ASSERT_EQ(neurons[1].received_count, 1);
@@ -71,7 +101,7 @@ TEST(SynapsePopulation, DeliverStateful) {
 	Int32 spikes[] = {0, 1};
 	auto syn       = setup<stateful_synapse>();
 
-	syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, {});
+	syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, {}, pool);
 
 	ASSERT_EQ(neurons[0].received_count, 2);
 	ASSERT_EQ(neurons[1].received_count, 2);
@@ -82,14 +112,26 @@ TEST(SynapsePopulation, DeliverStateful) {
 
 struct plastic_synapse {
 	struct synapse {
-		int update_count = 0;
+		int update_count = 0; // Steps processed so far, updated or skipped
+		step_log log;
 	};
 
 	void deliver(synapse const& syn, stateful_neuron::neuron& n) const {
 		n.received_count = syn.update_count;
+		n.log            = syn.log;
+	}
+	void update(synapse& syn, float, bool const pre, bool const post) const {
+		syn.log.updated.set(syn.update_count);
+		syn.log.pre[syn.update_count]  = pre;
+		syn.log.post[syn.update_count] = post;
+		syn.update_count++;
+	}
+	void skip(synapse& syn, float, Int const steps) const {
+		SPICE_PRE(steps >= 0);
+		for (Int i : range(steps))
+			syn.log.skipped.set(syn.update_count + i);
+		syn.update_count += steps;
 	}
-	void update(synapse& syn, float, bool, bool) const { syn.update_count++; }
-	void skip(synapse& syn, float, Int steps) const { syn.update_count += steps; }
 };
 static_assert(PlasticSynapse<plastic_synapse> && DeliverTo<plastic_synapse, stateful_neuron>);
 
@@ -100,7 +142,7 @@ TEST(SynapsePopulation, DeliverPlastic) {
 		Int32 spikes[] = {1, 2};
 		auto syn       = setup<plastic_synapse>();
 
-		syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, hist);
+		syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
 
 		ASSERT_EQ(neurons[3].received_count, 1);
 		ASSERT_EQ(neurons[4].received_count, 1);
@@ -111,8 +153,8 @@ TEST(SynapsePopulation, DeliverPlastic) {
 		Int32 spikes[] = {1, 2};
 		auto syn       = setup<plastic_synapse>();
 
-		syn.update(0, 1, 3, hist);
-		syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, hist);
+		syn.update(0, 1, 0, 3, hist, pool);
+		syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
 
 		ASSERT_EQ(neurons[3].received_count, 1);
 		ASSERT_EQ(neurons[4].received_count, 1);
@@ -123,9 +165,9 @@ TEST(SynapsePopulation, DeliverPlastic) {
 		Int32 spikes[] = {1, 2};
 		auto syn       = setup<plastic_synapse>();
 
-		syn.update(0, 1, 3, hist);
-		syn.update(0, 1, 3, hist);
-		syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, hist);
+		syn.update(0, 1, 0, 3, hist, pool);
+		syn.update(0, 1, 0, 3, hist, pool);
+		syn.deliver(0, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
 
 		ASSERT_EQ(neurons[3].received_count, 1);
 		ASSERT_EQ(neurons[4].received_count, 1);
@@ -136,8 +178,8 @@ TEST(SynapsePopulation, DeliverPlastic) {
 		Int32 spikes[] = {1, 2};
 		auto syn       = setup<plastic_synapse>();
 
-		syn.update(0, 1, 3, hist);
-		syn.deliver(1, 1, spikes, nullptr, 0, neurons, 5, hist);
+		syn.update(0, 1, 0, 3, hist, pool);
+		syn.deliver(1, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
 
 		ASSERT_EQ(neurons[3].received_count, 2);
 		ASSERT_EQ(neurons[4].received_count, 2);
@@ -148,10 +190,14 @@ TEST(SynapsePopulation, DeliverPlastic) {
 		Int32 spikes[] = {1, 2};
 		auto syn       = setup<plastic_synapse>();
 
-		syn.deliver(9, 1, spikes, nullptr, 0, neurons, 5, hist);
+		syn.deliver(9, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
 
 		ASSERT_EQ(neurons[3].received_count, 10);
 		ASSERT_EQ(neurons[4].received_count, 10);
+		for (Int i : {3, 4}) {
+			ASSERT_EQ(neurons[i].log.updated, steps({}));
+			ASSERT_EQ(neurons[i].log.skipped, steps(0, 10));
+		}
 	}
 	{ // Skip ahead to time step=10, 10 updates should be performed.
 		stateful_neuron::neuron neurons[5];
@@ -159,10 +205,182 @@ TEST(SynapsePopulation, DeliverPlastic) {
 		Int32 spikes[] = {1, 2};
 		auto syn       = setup<plastic_synapse>();
 
-		syn.update(4, 1, 3, hist);
-		syn.deliver(9, 1, spikes, nullptr, 0, neurons, 5, hist);
+		syn.update(4, 1, 0, 3, hist, pool);
+		syn.deliver(9, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
 
 		ASSERT_EQ(neurons[3].received_count, 10);
 		ASSERT_EQ(neurons[4].received_count, 10);
 	}
+	{ // Postsynaptic spikes are updated at the step they occurred, all other steps are skipped
+		stateful_neuron::neuron neurons[5];
+		UInt hist[5]   = {0};
+		Int32 spikes[] = {1, 2};
+		auto syn       = setup<plastic_synapse>();
+
+		spike(hist[3], 2);
+		spike(hist[3], 5);
+		spike(hist[4], 9);
+		syn.deliver(9, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
+
+		ASSERT_EQ(neurons[3].log.updated, steps({2, 5}));
+		ASSERT_EQ(neurons[3].log.skipped, steps(0, 10) & ~steps({2, 5}));
+		ASSERT_EQ(neurons[3].log.pre, steps({}));
+		ASSERT_EQ(neurons[3].log.post, steps({2, 5}));
+		ASSERT_EQ(neurons[4].log.updated, steps({9}));
+		ASSERT_EQ(neurons[4].log.skipped, steps(0, 9));
+		ASSERT_EQ(neurons[4].log.post, steps({9}));
+
+		// The spikes delivered during step 9 are processed during step 10, together with the
+		// postsynaptic spike of that step. Spikes before 10 mustn't be processed twice.
+		spike(hist[3], 10);
+		spike(hist[3], 11);
+		spike(hist[4], 12);
+		syn.deliver(12, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
+
+		ASSERT_EQ(neurons[3].received_count, 13);
+		ASSERT_EQ(neurons[3].log.updated, steps({2, 5, 10, 11}));
+		ASSERT_EQ(neurons[3].log.skipped, steps(0, 13) & ~steps({2, 5, 10, 11}));
+		ASSERT_EQ(neurons[3].log.pre, steps({10}));
+		ASSERT_EQ(neurons[3].log.post, steps({2, 5, 10, 11}));
+		ASSERT_EQ(neurons[4].received_count, 13);
+		ASSERT_EQ(neurons[4].log.updated, steps({9, 10, 12}));
+		ASSERT_EQ(neurons[4].log.skipped, steps(0, 13) & ~steps({9, 10, 12}));
+		ASSERT_EQ(neurons[4].log.pre, steps({10}));
+		ASSERT_EQ(neurons[4].log.post, steps({9, 12}));
+	}
+	{ // Histories wrap around after 64 steps, spikes before a catch-up update aren't seen again
+		stateful_neuron::neuron neurons[5];
+		UInt hist[5]   = {0};
+		Int32 spikes[] = {1, 2};
+		auto syn       = setup<plastic_synapse>();
+
+		spike(hist[3], 60);
+		syn.update(63, 1, 0, 3, hist, pool);
+		spike(hist[3], 66);
+		spike(hist[3], 70);
+		syn.deliver(70, 1, spikes, nullptr, 0, neurons, 5, hist, pool);
+
+		ASSERT_EQ(neurons[3].received_count, 71);
+		ASSERT_EQ(neurons[3].log.updated, steps({60, 66, 70}));
+		ASSERT_EQ(neurons[3].log.skipped, steps(0, 71) & ~steps({60, 66, 70}));
+		ASSERT_EQ(neurons[3].log.pre, steps({}));
+		ASSERT_EQ(neurons[3].log.post, steps({60, 66, 70}));
+		ASSERT_EQ(neurons[4].log.updated, steps({}));
+		ASSERT_EQ(neurons[4].log.skipped, steps(0, 71));
+	}
+}
+
+// Catches up on plasticity in 'slices' slices spread across every 64 steps (0 = never)
+template <class Syn>
+static std::vector<stateful_neuron::neuron>
+deliver_random(Int const threads, Int const slices = 0, Int const bucket_size = 0,
+               bool const procedural = false) {
+	seed_seq seed({1337});
+	thread_pool workers(threads);
+
+	fixed_probability fprob(0.3);
+	synapse_population<Syn, stateless_neuron, stateful_neuron> syn(
+	    {}, fprob(100, 1000), seed, 1, workers, bucket_size, procedural);
+
+	std::vector<stateful_neuron::neuron> neurons(1000);
+	std::vector<UInt> hist(1000);
+	std::vector<Int32> spikes{0, 7, 8, 9, 50, 99};
+	for (Int time : range(70)) {
+		for (Int i : range(hist)) {
+			hist[i] &= ~(1_u64 << (63 - time % 64));
+			if ((i + time) % 13 == 0)
+				spike(hist[i], time);
+		}
+
+		if (slices > 0 && time % (64 / slices) == 0) {
+			Int const k = time % 64 / (64 / slices);
+			syn.update(time, 1, k * 100 / slices, (k + 1) * 100 / slices, hist, workers);
+		}
+		syn.deliver(time, 1, spikes, nullptr, 0, neurons.data(), neurons.size(), hist, workers);
+	}
+
+	return neurons;
+}
+
+// Every source spikes during every step of deliver_random(). So a plastic synapse receives its
+// presynaptic spike during steps 1..69, and postsynaptic ones whenever its destination spiked.
+static void expect_plastic(std::vector<stateful_neuron::neuron> const& neurons) {
+	for (Int dst : range(neurons)) {
+		auto const& log = neurons[dst].log;
+		if (neurons[dst].received_count == 0) // Not connected to any source
+			continue;
+
+		std::bitset<128> post;
+		for (Int step : range(70))
+			post[step] = (dst + step) % 13 == 0;
+
+		ASSERT_EQ(neurons[dst].received_count, 70) << dst;
+		ASSERT_EQ(log.pre, steps(1, 70)) << dst;
+		ASSERT_EQ(log.post, post) << dst;
+		ASSERT_EQ(log.updated, steps(1, 70) | (post & steps({0}))) << dst;
+		ASSERT_EQ(log.skipped, steps({0}) & ~post) << dst;
+	}
+}
+
+TEST(SynapsePopulation, DeliverPartitioned) {
+	auto compare = []<class Syn>() {
+		auto const expected = deliver_random<Syn>(1);
+		for (Int threads : {2, 3, 8}) {
+			auto const actual = deliver_random<Syn>(threads);
+			for (Int i : range(expected)) {
+				ASSERT_EQ(actual[i].received_count, expected[i].received_count);
+				ASSERT_EQ(actual[i].log, expected[i].log);
+			}
+		}
+	};
+
+	compare.template operator()<stateless_synapse>();
+	compare.template operator()<stateful_synapse>();
+	compare.template operator()<plastic_synapse>();
+	expect_plastic(deliver_random<plastic_synapse>(1));
+}
+
+TEST(SynapsePopulation, UpdateParallel) {
+	auto const expected = deliver_random<plastic_synapse>(1, 1);
+	expect_plastic(expected);
+	for (Int threads : {1, 2, 8})
+		for (Int slices : {1, 4, 64}) {
+			auto const actual = deliver_random<plastic_synapse>(threads, slices);
+			for (Int i : range(expected)) {
+				ASSERT_EQ(actual[i].received_count, expected[i].received_count)
+				    << threads << " threads, " << slices << " slices";
+				ASSERT_EQ(actual[i].log, expected[i].log)
+				    << threads << " threads, " << slices << " slices";
+			}
+		}
+}
+
+TEST(SynapsePopulation, DeliverBucketed) {
+	auto compare = []<class Syn>() {
+		auto const expected = deliver_random<Syn>(1);
+		for (Int threads : {1, 3})
+			for (Int bucket_size : {1, 7, 1000, 5000}) {
+				auto const actual = deliver_random<Syn>(threads, 0, bucket_size);
+				for (Int i : range(expected)) {
+					ASSERT_EQ(actual[i].received_count, expected[i].received_count)
+					    << threads << " threads, buckets of " << bucket_size;
+					ASSERT_EQ(actual[i].log, expected[i].log)
+					    << threads << " threads, buckets of " << bucket_size;
+				}
+			}
+	};
+
+	compare.template operator()<stateless_synapse>();
+	compare.template operator()<stateful_synapse>();
+	compare.template operator()<plastic_synapse>();
+}
+
+TEST(SynapsePopulation, DeliverProcedural) {
+	auto const expected = deliver_random<stateless_synapse>(1);
+	for (Int threads : {1, 3, 8}) {
+		auto const actual = deliver_random<stateless_synapse>(threads, 0, 0, true);
+		for (Int i : range(expected))
+			ASSERT_EQ(actual[i].received_count, expected[i].received_count)
+			    << threads << " threads";
+	}
 }
\ No newline at end of file
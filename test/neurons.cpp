@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "spice/detail/neuron_population.h"
+#include "spice/neurons.h"
+
+using namespace spice;
+using namespace spice::detail;
+using namespace spice::util;
+
+static_assert(CheckNeuron<poisson_source>());
+static_assert(PerRangeUpdate<poisson_source> && !PerNeuronUpdate<poisson_source>);
+
+static std::vector<Int32> to_vector(std::span<Int32 const> spikes) {
+	return {spikes.begin(), spikes.end()};
+}
+
+TEST(Poisson, Rate) {
+	seed_seq seed{1337};
+	thread_pool pool;
+	Int const size = 100'000;
+	neuron_population<poisson_source> pop({20}, size, seed, 1);
+
+	Int total = 0;
+	for (Int step : range(100)) {
+		pop.update(1e-4, seed.stream(step), pool);
+
+		auto const spikes = to_vector(pop.spikes(0));
+		ASSERT_TRUE(std::is_sorted(spikes.begin(), spikes.end()));
+		ASSERT_EQ(std::adjacent_find(spikes.begin(), spikes.end()), spikes.end());
+		ASSERT_TRUE(spikes.empty() || (spikes.front() >= 0 && spikes.back() < size));
+		total += spikes.size();
+	}
+
+	// Expect 100 steps * 100'000 neurons * 20Hz * 0.1ms = 20'000 spikes, stddev ~141
+	EXPECT_NEAR(total, 20'000, 1'000);
+}
+
+TEST(Poisson, ChangeRate) {
+	seed_seq seed{1337};
+	thread_pool pool;
+	neuron_population<poisson_source> pop({}, 1000, seed, 1);
+
+	pop.update(1e-4, seed, pool);
+	ASSERT_EQ(pop.spikes(0).size(), 0);
+
+	pop.get_neuron().rate = 1e4;
+	pop.update(1e-4, seed, pool);
+	ASSERT_EQ(pop.spikes(0).size(), 1000);
+
+	pop.get_neuron().rate = 2e4;
+	pop.update(1e-4, seed, pool);
+	ASSERT_EQ(pop.spikes(0).size(), 1000);
+}
+
+// Spikes depend neither on the number of threads nor on which neurons are owned
+TEST(Poisson, Deterministic) {
+	seed_seq seed{1337};
+	Int const size = 3 * block_size + 5;
+
+	thread_pool pool1;
+	neuron_population<poisson_source> expected({500}, size, seed, 1);
+	expected.update(1e-3, seed, pool1);
+	ASSERT_GT(expected.spikes(0).size(), 0);
+
+	thread_pool pool3(3);
+	neuron_population<poisson_source> actual({500}, size, seed, 1);
+	actual.update(1e-3, seed, pool3);
+	ASSERT_EQ(to_vector(actual.spikes(0)), to_vector(expected.spikes(0)));
+
+	Int const first = block_size / 2;
+	Int const last  = 2 * block_size + 3;
+	neuron_population<poisson_source> owned({500}, size, seed, 1);
+	ASSERT_TRUE(owned.own(first, last));
+	owned.update(1e-3, seed, pool3);
+
+	std::vector<Int32> owned_spikes;
+	for (Int32 s : expected.spikes(0))
+		if (first <= s && s < last)
+			owned_spikes.push_back(s);
+	ASSERT_EQ(to_vector(owned.spikes(0)), owned_spikes);
+}
\ No newline at end of file
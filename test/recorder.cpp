@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "spice/recorder.h"
+#include "spice/snn.h"
+
+using namespace spice;
+using namespace spice::util;
+
+struct poisson {
+	bool update(float const dt, auto& rng) const {
+		return util::generate_canonical<float>(rng) < (200 * dt);
+	}
+};
+
+struct lif {
+	struct neuron {
+		float V   = 0;
+		int Twait = 0;
+	};
+
+	bool update(neuron& n, float const dt, auto&) const {
+		if (--n.Twait <= 0) {
+			if (n.V > 0.02f) {
+				n.V     = 0;
+				n.Twait = 20;
+				return true;
+			}
+
+			n.V -= n.V * (dt * 50);
+		}
+		return false;
+	}
+};
+
+struct fixed_weight {
+	float weight;
+	void deliver(lif::neuron& to) const { to.V += weight; }
+};
+
+static std::string const path =
+    (std::filesystem::temp_directory_path() / "spice_recorder_test.spk").string();
+
+TEST(SpikeRecorder, RoundTrip) {
+	// Spikes of P and E of every step
+	std::vector<std::vector<std::vector<Int32>>> expected;
+	{
+		snn net(1e-4, 3e-4, {1337}, 2);
+		auto P = net.add_population<poisson>(3000);
+		auto E = net.add_population<lif>(1000);
+		net.connect<fixed_weight>(P, E, fixed_probability(0.1), 3e-4, {0.001});
+
+		// Tiny chunks, so the writer gets to write many of them
+		spike_recorder rec(path, {P, E}, 100);
+		for (Int t = 0; t < 300; t += 3) {
+			net.run(3);
+			rec.record(3);
+			for (Int age = 2; age >= 0; age--)
+				expected.push_back({{P->spikes(age).begin(), P->spikes(age).end()},
+				                    {E->spikes(age).begin(), E->spikes(age).end()}});
+		}
+		rec.flush();
+		for (Int t = 0; t < 10; t++) {
+			net.step();
+			rec.record();
+			expected.push_back({{P->spikes(0).begin(), P->spikes(0).end()},
+			                    {E->spikes(0).begin(), E->spikes(0).end()}});
+		}
+	}
+
+	spike_reader reader(path);
+	ASSERT_EQ(reader.sizes(), (std::vector<Int>{3000, 1000}));
+
+	Int step = 0;
+	std::vector<std::vector<Int32>> spikes;
+	Int last = -1;
+	Int e    = 0;
+	while (reader.next(step, spikes)) {
+		ASSERT_GT(step, last);
+		// Steps without spikes are skipped
+		for (Int i = last + 1; i < step; i++)
+			ASSERT_TRUE(expected[i][0].empty() && expected[i][1].empty()) << i;
+		ASSERT_EQ(spikes, expected[step]) << step;
+
+		last = step;
+		e += spikes[1].size();
+	}
+	ASSERT_EQ(last, 309);
+	ASSERT_GT(e, 0);
+
+	std::remove(path.c_str());
+}
+
+static std::vector<std::pair<Int, std::vector<std::vector<Int32>>>> read_all() {
+	std::vector<std::pair<Int, std::vector<std::vector<Int32>>>> result;
+	spike_reader reader(path);
+	Int step = 0;
+	std::vector<std::vector<Int32>> spikes;
+	while (reader.next(step, spikes))
+		result.push_back({step, spikes});
+	return result;
+}
+
+// Records run()s that span several blocks of min_delay steps
+TEST(SpikeRecorder, Run) {
+	auto const simulate = [](bool const run) {
+		// max_delay = 5, min_delay = 2
+		snn net(1e-4, 5e-4, {1337}, 2);
+		auto P = net.add_population<poisson>(3000);
+		auto E = net.add_population<lif>(1000);
+		net.connect<fixed_weight>(P, E, fixed_probability(0.1), 2e-4, {0.001});
+
+		spike_recorder rec(path, {P, E});
+		for (Int t = 0; t < 200; t += 5) {
+			if (run) {
+				net.run(5);
+				rec.record(5);
+			} else
+				for (Int i = 0; i < 5; i++) {
+					net.step();
+					rec.record();
+				}
+		}
+		rec.flush();
+		return read_all();
+	};
+
+	auto const stepped = simulate(false);
+	auto const ran     = simulate(true);
+	ASSERT_GT(stepped.size(), 100);
+	ASSERT_EQ(ran, stepped);
+
+	std::remove(path.c_str());
+}
+
+TEST(SpikeRecorder, Errors) {
+	ASSERT_THROW(spike_reader("/nonexistent/spikes.spk"), std::system_error);
+	ASSERT_THROW(spike_recorder("/nonexistent/spikes.spk", {}), std::system_error);
+
+	std::FILE* const file = std::fopen(path.c_str(), "wb");
+	std::fputs("not a spike file", file);
+	std::fclose(file);
+	ASSERT_THROW(spike_reader{path}, std::runtime_error);
+
+	std::remove(path.c_str());
+}
\ No newline at end of file
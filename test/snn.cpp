@@ -1,3 +1,481 @@
 #include "gtest/gtest.h"
 
-#include "spice/snn.h"
\ No newline at end of file
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "spice/snn.h"
+
+using namespace spice;
+using namespace spice::util;
+
+struct poisson {
+	bool update(float const dt, auto& rng) const {
+		return util::generate_canonical<float>(rng) < (100 * dt);
+	}
+};
+
+struct lif {
+	struct neuron {
+		float V   = 0;
+		int Twait = 0;
+	};
+
+	bool update(neuron& n, float const dt, auto&) const {
+		if (--n.Twait <= 0) {
+			if (n.V > 0.02f) {
+				n.V     = 0;
+				n.Twait = 20;
+				return true;
+			}
+
+			n.V -= n.V * (dt * 50);
+		}
+		return false;
+	}
+};
+
+struct fixed_weight {
+	float weight;
+	void deliver(lif::neuron& to) const { to.V += weight; }
+};
+
+// lif, updated in batches (see PerBatchUpdate)
+struct batch_lif {
+	struct neuron {
+		float V     = 0;
+		Int32 Twait = 0;
+	};
+	struct batch {
+		simd<float> V;
+		simd<Int32> Twait;
+	};
+
+	UInt32 update(batch& b, float const dt, auto&) const {
+		auto const ready  = --b.Twait <= 0;
+		auto const spiked = ready & (b.V > 0.02f);
+		b.V               = spiked ? 0.0f : ready ? b.V - b.V * (dt * 50) : b.V;
+		b.Twait           = spiked ? Int32(20) : b.Twait;
+		return to_bitmask(spiked);
+	}
+};
+BOOST_HANA_ADAPT_STRUCT(batch_lif::neuron, V, Twait);
+BOOST_HANA_ADAPT_STRUCT(batch_lif::batch, V, Twait);
+static_assert(PerBatchUpdate<batch_lif>);
+
+struct batch_weight {
+	float weight;
+	void deliver(batch_lif::neuron& to) const { to.V += weight; }
+};
+
+struct plastic {
+	struct synapse {
+		float W    = 1e-4;
+		float Zpre = 0;
+	};
+
+	void deliver(synapse const& syn, lif::neuron& to) const { to.V += syn.W; }
+	void update(synapse& syn, float const, bool const pre, bool const post) const {
+		syn.W = std::clamp(syn.W + post * 1e-5f * syn.Zpre - pre * 1e-6f, 0.0f, 3e-4f);
+		syn.Zpre += pre;
+		syn.Zpre *= 0.99f;
+	}
+	void skip(synapse& syn, float const, Int const n) const { syn.Zpre *= std::pow(0.99f, n); }
+};
+
+// Initialized with a random weight
+struct random_weight {
+	struct synapse {
+		float W = 0;
+	};
+
+	void init(synapse& syn, Int, Int, auto& rng) const {
+		syn.W = util::generate_canonical<float>(rng) * 8e-4f;
+	}
+	void deliver(synapse const& syn, lif::neuron& to) const { to.V += syn.W; }
+};
+
+struct from_to {
+	void deliver(lif::neuron const& from, lif::neuron& to) const { to.V += from.V * 0.01f; }
+};
+
+struct options {
+	Int threads        = 1;
+	Int steps_per_call = 1; // calls run(steps_per_call) repeatedly
+	numa_policy numa   = numa_policy::local;
+	transport* comm    = nullptr;
+	bool from_to       = true; // not supported by distributed simulations
+	delivery mode      = delivery::scatter;
+	bool reorder       = false; // see snn::finalize()
+	Int save_after     = -1;    // saves a checkpoint after this many steps
+	bool resume        = false; // resumes from it instead, simulating the remaining steps
+};
+
+// A neuron and synapse counting their initializations
+struct counted {
+	static inline Int inits = 0;
+	struct neuron {
+		float V = 0;
+	};
+	struct synapse {
+		float W = 0;
+	};
+
+	void init(neuron& n, Int, auto&) const {
+		n.V = 0.01f;
+		inits++;
+	}
+	bool update(neuron&, float, auto&) const { return false; }
+	void init(synapse& syn, Int, Int, auto&) const {
+		syn.W = 0.01f;
+		inits++;
+	}
+	void deliver(synapse const& syn, neuron& to) const { to.V += syn.W; }
+};
+
+// A neuron and synapse whose state isn't trivially copyable, so they can't be saved
+struct traced {
+	struct neuron {
+		std::vector<float> V;
+	};
+	struct synapse {
+		std::vector<float> W{0.01f};
+	};
+
+	bool update(neuron&, float, auto&) const { return false; }
+	void deliver(synapse const& syn, lif::neuron& to) const { to.V += syn.W[0]; }
+};
+
+static std::string const checkpoint_path =
+    (std::filesystem::temp_directory_path() / "spice_snn_test.ckpt").string();
+
+// Simulates 200 steps
+static std::vector<std::vector<Int32>> simulate(options const& opt) {
+	Int const N = 5000;
+
+	snn net(1e-4, 3e-4, {1337});
+	net.set_threads(opt.threads);
+	net.set_numa_policy(opt.numa);
+	if (opt.comm)
+		net.distribute(*opt.comm);
+	if (opt.resume)
+		net.load(checkpoint_path);
+
+	auto P = net.add_population<poisson>(N / 2);
+	auto E = net.add_population<lif>(N * 4 / 10);
+	auto I = net.add_population<lif>(N / 10);
+
+	// Plastic synapses can't be procedural
+	auto const plastic_mode = opt.mode == delivery::procedural ? delivery::scatter : opt.mode;
+
+	net.connect<fixed_weight>(P, E, fixed_probability(0.1), 3e-4, {2.0 / N}, opt.mode);
+	net.connect<fixed_weight>(P, I, fixed_probability(0.1), 3e-4, {2.0 / N}, opt.mode);
+	net.connect<plastic>(E, E, fixed_probability(0.1), 2e-4, {}, plastic_mode);
+	net.connect<random_weight>(E, I, fixed_probability(0.1), 2e-4, {}, plastic_mode);
+	if (opt.from_to)
+		net.connect<from_to>(I, E, fixed_probability(0.1), 3e-4, {}, opt.mode);
+	else
+		net.connect<fixed_weight>(I, E, fixed_probability(0.1), 3e-4, {-10.0 / N}, opt.mode);
+	net.connect<fixed_weight>(I, I, fixed_probability(0.1), 3e-4, {-10.0 / N}, opt.mode);
+	net.finalize(opt.reorder);
+
+	std::vector<std::vector<Int32>> result;
+	for (Int t = opt.resume ? opt.save_after : 0; t < 200; t += opt.steps_per_call) {
+		Int const steps = std::min<Int>(opt.steps_per_call, 200 - t);
+		if (steps == 1)
+			net.step();
+		else
+			net.run(steps);
+		if (!opt.resume && t + steps == opt.save_after)
+			net.save(checkpoint_path);
+
+		for (Int age = steps - 1; age >= 0; age--) {
+			result.emplace_back();
+			for (auto pop : std::initializer_list<spice::detail::NeuronPopulation const*>{P, E, I})
+				result.back().insert(result.back().end(), pop->spikes(age).begin(),
+				                     pop->spikes(age).end());
+		}
+	}
+
+	return result;
+}
+
+TEST(SNN, Threads) {
+	snn net(1, 1, {1337}, 3);
+	ASSERT_EQ(net.threads(), 3);
+	net.set_threads(2);
+	ASSERT_EQ(net.threads(), 2);
+}
+
+TEST(SNN, Deterministic) {
+	auto const expected = simulate({});
+
+	Int spike_count = 0;
+	for (auto const& spikes : expected)
+		spike_count += spikes.size();
+	ASSERT_GT(spike_count, 0);
+
+	for (Int threads : {2, 4})
+		ASSERT_EQ(simulate({.threads = threads}), expected) << threads << " threads";
+}
+
+TEST(SNN, Bucketed) {
+	auto const expected = simulate({});
+	for (Int threads : {1, 3})
+		ASSERT_EQ(simulate({.threads = threads, .mode = delivery::bucketed}), expected)
+		    << threads << " threads";
+}
+
+TEST(SNN, Procedural) {
+	for (bool from_to : {true, false}) {
+		auto const expected = simulate({.from_to = from_to});
+		for (Int threads : {1, 3})
+			for (bool reorder : {false, true})
+				ASSERT_EQ(simulate({.threads = threads,
+				                    .from_to = from_to,
+				                    .mode    = delivery::procedural,
+				                    .reorder = reorder}),
+				          expected)
+				    << threads << " threads, from_to: " << from_to << ", reorder: " << reorder;
+	}
+}
+
+TEST(SNN, Reorder) {
+	// With from_to, I's state is read by synapses, so only E gets reordered
+	for (bool from_to : {true, false}) {
+		auto const expected = simulate({.from_to = from_to});
+		for (Int threads : {1, 3})
+			for (delivery mode : {delivery::scatter, delivery::bucketed})
+				ASSERT_EQ(simulate({.threads = threads,
+				                    .from_to = from_to,
+				                    .mode    = mode,
+				                    .reorder = true}),
+				          expected)
+				    << threads << " threads, from_to: " << from_to;
+	}
+}
+
+// Reordered batch populations, whose last batch is partial
+TEST(SNN, ReorderBatch) {
+	auto const simulate = [](bool const reorder) {
+		snn net(1e-4, 1e-4, {1337});
+		auto P = net.add_population<poisson>(100);
+		auto Q = net.add_population<batch_lif>(13);
+		net.connect<batch_weight>(P, Q, fixed_probability(0.5), 1e-4, {0.005});
+		net.finalize(reorder);
+
+		std::vector<std::vector<Int32>> spikes;
+		for ([[maybe_unused]] Int t : range(200)) {
+			net.step();
+			spikes.emplace_back(Q->spikes(0).begin(), Q->spikes(0).end());
+		}
+		return spikes;
+	};
+
+	auto const expected = simulate(false);
+	ASSERT_GT(std::count_if(expected.begin(), expected.end(), [](auto& s) { return !s.empty(); }),
+	          0);
+	ASSERT_EQ(simulate(true), expected);
+}
+
+TEST(SNN, Run) {
+	auto const expected = simulate({});
+
+	for (Int threads : {1, 4})
+		for (Int steps_per_call : {2, 3})
+			ASSERT_EQ(simulate({.threads = threads, .steps_per_call = steps_per_call}), expected)
+			    << threads << " threads, " << steps_per_call << " steps per call";
+}
+
+TEST(SNN, NUMA) {
+	auto const expected = simulate({});
+	for (auto numa : {numa_policy::interleave, numa_policy::partition})
+		ASSERT_EQ(simulate({.threads = 3, .numa = numa}), expected);
+
+	snn net(1, 1, {1337}, 2);
+	auto P = net.add_population<lif>(1000);
+	net.set_numa_policy(numa_policy::partition);
+	ASSERT_EQ(net.numa_policy(), numa_policy::partition);
+	net.connect<plastic>(P, P, fixed_probability(0.1), 1);
+
+	std::vector<std::string> buffers;
+	for (auto const& p : net.placement()) {
+		buffers.push_back(p.buffer);
+		ASSERT_EQ(p.pages.size(), numa_node_count());
+	}
+	ASSERT_EQ(buffers, (std::vector<std::string>{"population 0: neurons",
+	                                             "population 0: history", "connection 0: offsets",
+	                                             "connection 0: neighbors", "connection 0: edges",
+	                                             "connection 0: ages"}));
+}
+
+TEST(SNN, Memory) {
+	snn net(1, 1, {1337});
+	auto P = net.add_population<lif>(1000);
+	auto Q = net.add_population<lif>(100'000);
+	ASSERT_EQ(net.memory().bytes, 0);
+
+	// 16-bit neighbors and 32-bit offsets take exactly half the space
+	net.connect<fixed_weight>(P, P, fixed_probability(0.1), 1, {1});
+	auto const narrow = net.memory();
+	ASSERT_GT(narrow.bytes, 0);
+	ASSERT_EQ(narrow.bytes * 2, narrow.wide_bytes);
+
+	// 32-bit neighbors
+	net.connect<fixed_weight>(P, Q, fixed_probability(0.01), 1, {1});
+	auto const wide = net.memory();
+	ASSERT_EQ(wide.bytes - narrow.bytes, wide.wide_bytes - narrow.wide_bytes - 1001 * 4);
+
+	// Procedural connections store nothing
+	net.connect<fixed_weight>(Q, Q, fixed_probability(0.1), 1, {1}, delivery::procedural);
+	ASSERT_EQ(net.memory().bytes, wide.bytes);
+}
+
+TEST(SNN, SharedTopology) {
+	// Connects P to Q and Q to P with the same adj_list, or with a copy of its edges
+	auto const simulate = [](bool const shared) {
+		snn net(1e-4, 1e-4, {1337});
+		auto P = net.add_population<poisson>(1000);
+		auto Q = net.add_population<lif>(1000);
+
+		adj_list adj, copy;
+		for (Int i : range(1000))
+			for (Int j = i % 7; j < 1000; j += 50) {
+				adj.connect(i, j);
+				copy.connect(i, j);
+			}
+		net.connect<fixed_weight>(P, Q, adj, 1e-4, {0.01});
+		net.connect<fixed_weight>(Q, Q, shared ? adj : copy, 1e-4, {-0.001});
+
+		std::vector<std::vector<Int32>> spikes;
+		for ([[maybe_unused]] Int t : range(100)) {
+			net.step();
+			spikes.emplace_back(Q->spikes(0).begin(), Q->spikes(0).end());
+		}
+		return std::pair(spikes, net.memory());
+	};
+
+	auto const [expected, separate] = simulate(false);
+	auto const [actual, shared]     = simulate(true);
+	ASSERT_EQ(actual, expected);
+	ASSERT_GT(std::count_if(actual.begin(), actual.end(), [](auto& s) { return !s.empty(); }), 0);
+	ASSERT_EQ(shared.bytes * 2, separate.bytes);
+}
+
+TEST(SNN, Checkpoint) {
+	for (delivery mode : {delivery::scatter, delivery::procedural})
+		for (bool reorder : {false, true}) {
+			auto const expected = simulate({.mode = mode, .reorder = reorder, .save_after = 100});
+			// Threads don't matter, the layout is taken from the checkpoint
+			auto const resumed =
+			    simulate({.threads = 3, .mode = mode, .save_after = 100, .resume = true});
+			ASSERT_EQ(resumed, std::vector(expected.begin() + 100, expected.end()))
+			    << "reorder: " << reorder;
+		}
+
+	// Shared structures stay shared
+	auto const build = [](bool const resume) {
+		auto net = std::make_unique<snn>(1e-4, 1e-4, seed_seq{1337});
+		if (resume)
+			net->load(checkpoint_path);
+		auto P = net->add_population<lif>(1000);
+		adj_list adj;
+		for (Int i : range(1000))
+			adj.connect(i, (i * 7) % 1000);
+		net->connect<fixed_weight>(P, P, adj, 1e-4, {0.01});
+		net->connect<plastic>(P, P, adj, 1e-4);
+		net->step();
+		return net;
+	};
+	build(false)->save(checkpoint_path);
+	ASSERT_EQ(build(true)->memory().bytes, build(false)->memory().bytes);
+
+	// Restored neurons and synapses aren't initialized
+	auto const count = [](bool const resume) {
+		snn net(1e-4, 1e-4, {1337});
+		if (resume)
+			net.load(checkpoint_path);
+		auto P = net.add_population<counted>(100);
+		net.connect<counted>(P, P, fixed_probability(0.1), 1e-4);
+		net.step();
+		if (!resume)
+			net.save(checkpoint_path);
+		return P->get_neurons()[0].V;
+	};
+	counted::inits    = 0;
+	float const V     = count(false);
+	Int const created = counted::inits;
+	ASSERT_GT(created, 100);
+	ASSERT_EQ(count(true), V);
+	ASSERT_EQ(counted::inits, created);
+
+	// Different networks are rejected
+	snn net(1e-4, 1e-4, {1337});
+	net.load(checkpoint_path);
+	ASSERT_THROW(net.add_population<lif>(999), std::runtime_error);
+
+	// State that isn't trivially copyable is simulated, but not saved
+	for (bool const neurons : {false, true}) {
+		snn traced_net(1e-4, 1e-4, {1337});
+		auto P = traced_net.add_population<poisson>(100);
+		if (neurons)
+			traced_net.add_population<traced>(100);
+		else
+			traced_net.connect<traced>(P, traced_net.add_population<lif>(100),
+			                           fixed_probability(0.1), 1e-4);
+		traced_net.step();
+		ASSERT_THROW(traced_net.save(checkpoint_path), std::runtime_error);
+	}
+
+	std::remove(checkpoint_path.c_str());
+}
+
+TEST(SNN, Distributed) {
+	auto const expected = simulate({.from_to = false});
+
+	auto const memory = [](transport* const comm) {
+		snn net(1e-4, 1e-4, {1337});
+		if (comm)
+			net.distribute(*comm);
+		auto P = net.add_population<poisson>(1000);
+		auto Q = net.add_population<lif>(6000);
+
+		adj_list adj;
+		for (Int i : range(1000))
+			for (Int j = i % 7; j < 6000; j += 20)
+				adj.connect(i, j);
+		net.connect<fixed_weight>(P, Q, fixed_probability(0.1), 1e-4, {0.01});
+		net.connect<random_weight>(P, Q, adj, 1e-4);
+		return net.memory().bytes;
+	};
+	Int const single = memory(nullptr);
+	Int last         = single;
+
+	for (Int ranks : {2, 3}) {
+		auto comm = socket_transport::fork(ranks);
+		auto const actual =
+		    simulate({.threads = 2, .steps_per_call = 3, .comm = comm.get(), .from_to = false});
+		auto const procedural = simulate({.threads        = 2,
+		                                  .steps_per_call = 3,
+		                                  .comm           = comm.get(),
+		                                  .from_to        = false,
+		                                  .mode           = delivery::procedural});
+
+		Int const bytes = memory(comm.get());
+
+		if (comm->rank() != 0)
+			std::_Exit(0);
+		ASSERT_EQ(actual, expected) << ranks << " ranks";
+		ASSERT_EQ(procedural, expected) << ranks << " ranks, procedural";
+		ASSERT_GT(comm->statistics().exchanges, 0);
+
+		// Every rank stores (and generates) about 1/ranks of the synapses
+		ASSERT_LT(bytes, last);
+		ASSERT_LT(bytes * ranks, single * 1.1);
+		last = bytes;
+	}
+}
\ No newline at end of file
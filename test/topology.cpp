@@ -0,0 +1,189 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "spice/topology.h"
+#include "spice/util/range.h"
+#include "spice/util/thread_pool.h"
+
+using namespace spice;
+using namespace spice::util;
+
+static std::pair<std::vector<Int>, std::vector<Int32>> generate(Topology& c, Int const threads) {
+	thread_pool pool(threads);
+	std::vector<Int> offsets(c.src_count + 1);
+	std::vector<Int32> neighbors(c.size());
+	c.generate(offsets, neighbors, {1337}, pool);
+
+	neighbors.resize(offsets.back());
+	return {offsets, neighbors};
+}
+
+TEST(Topology, AdjList) {
+	adj_list adj;
+	adj.connect(2, 1);
+	adj.connect(0, 3);
+	adj.connect(2, 0);
+	adj(3, 4);
+
+	auto const [offsets, neighbors] = generate(adj, 1);
+	ASSERT_EQ(offsets, (std::vector<Int>{0, 1, 1, 3}));
+	ASSERT_EQ(neighbors, (std::vector<Int32>{3, 0, 1}));
+}
+
+TEST(Topology, AdjListParallel) {
+	adj_list adj;
+	for (Int i : range(200'000))
+		adj.connect((i * 7919) % 1000, (i * 104729) % 5000);
+	adj(1000, 5000);
+
+	std::vector<Int> offsets(1001);
+	std::vector<Int32> neighbors(adj.size());
+	edge_stream es(offsets, neighbors);
+	static_cast<Topology&>(adj).generate(es, {1337});
+	es.flush();
+
+	for (Int threads : {1, 2, 3, 8})
+		ASSERT_EQ(generate(adj, threads), std::pair(offsets, neighbors)) << threads << " threads";
+}
+
+TEST(Topology, FixedProbability) {
+	fixed_probability fprob(0.1);
+	fprob(1000, 2000);
+
+	auto const [offsets, neighbors] = generate(fprob, 1);
+	ASSERT_NEAR(neighbors.size(), 1000 * 2000 * 0.1, 1000 * 2000 * 0.1 * 0.05);
+
+	for (Int src : range(1000)) {
+		ASSERT_LE(offsets[src], offsets[src + 1]);
+		ASSERT_TRUE(std::is_sorted(neighbors.begin() + offsets[src],
+		                           neighbors.begin() + offsets[src + 1]));
+		for (Int i : range(offsets[src], offsets[src + 1]))
+			ASSERT_TRUE(0 <= neighbors[i] && neighbors[i] < 2000);
+	}
+
+	for (Int threads : {2, 3, 8})
+		ASSERT_EQ(generate(fprob, threads), std::pair(offsets, neighbors)) << threads << " threads";
+}
+
+// Narrow indices (see detail::csr) yield the same rows
+TEST(Topology, Narrow) {
+	adj_list adj;
+	for (Int i : range(20'000))
+		adj.connect((i * 7919) % 100, (i * 104729) % 65536);
+	adj(100, 65536);
+
+	fixed_probability fprob(0.1);
+	fprob(1000, 2000);
+
+	for (Topology* c : std::initializer_list<Topology*>{&adj, &fprob}) {
+		auto const [offsets, neighbors] = generate(*c, 1);
+
+		thread_pool pool(3);
+		std::vector<Int> offsets16(c->src_count + 1);
+		std::vector<UInt16> neighbors16(c->size());
+		c->generate(offsets16, neighbors16, {1337}, pool);
+		neighbors16.resize(offsets16.back());
+
+		ASSERT_EQ(offsets16, offsets);
+		ASSERT_TRUE(std::equal(neighbors16.begin(), neighbors16.end(), neighbors.begin(),
+		                       neighbors.end()));
+	}
+
+	// Via edge_stream
+	std::vector<Int> offsets(101);
+	std::vector<UInt16> neighbors(adj.size());
+	edge_stream es(offsets, std::span(neighbors));
+	static_cast<Topology&>(adj).generate(es, {1337});
+	es.flush();
+	auto const expected = generate(adj, 1);
+	ASSERT_EQ(offsets, expected.first);
+	ASSERT_TRUE(std::equal(neighbors.begin(), neighbors.end(), expected.second.begin(),
+	                       expected.second.end()));
+}
+
+// Slices hold the edges of the whole topology which target them, by default as well
+TEST(Topology, Slice) {
+	adj_list adj;
+	for (Int i : range(20'000))
+		adj.connect((i * 7919) % 100, (i * 104729) % 5000);
+	adj(100, 5000);
+
+	fixed_probability fprob(0.1);
+	fprob(100, 5000);
+
+	thread_pool pool(3);
+	for (Topology* c : std::initializer_list<Topology*>{&adj, &fprob}) {
+		auto const [offsets, neighbors] = generate(*c, 1);
+
+		for (bool base : {false, true}) {
+			std::vector<Int> slice_offsets(101);
+			std::vector<Int32> slice;
+			if (base)
+				c->Topology::generate_slice(1000, 2500, slice_offsets, slice, {1337}, pool);
+			else
+				c->generate_slice(1000, 2500, slice_offsets, slice, {1337}, pool);
+			ASSERT_EQ(slice.size(), slice_offsets.back());
+
+			for (Int src : range(100)) {
+				std::vector<Int32> expected;
+				for (Int i : range(offsets[src], offsets[src + 1]))
+					if (1000 <= neighbors[i] && neighbors[i] < 2500)
+						expected.push_back(neighbors[i]);
+				std::sort(expected.begin(), expected.end());
+
+				std::vector<Int32> actual(slice.begin() + slice_offsets[src],
+				                          slice.begin() + slice_offsets[src + 1]);
+				std::sort(actual.begin(), actual.end());
+				ASSERT_EQ(actual, expected) << src;
+			}
+		}
+	}
+}
+
+TEST(Topology, Procedural) {
+	adj_list adj;
+	ASSERT_FALSE(adj.procedural({1337}));
+
+	fixed_probability fprob(0.1);
+	fprob(1000, 2000);
+	auto const [offsets, neighbors] = generate(fprob, 3);
+
+	auto const rows = fprob.procedural({1337});
+	ASSERT_TRUE(rows);
+	std::vector<Int32> row(rows.max_degree);
+	for (Int src : range(1000)) {
+		Int const degree = rows.row(src, row);
+		ASSERT_EQ(degree, offsets[src + 1] - offsets[src]);
+		ASSERT_TRUE(
+		    std::equal(row.begin(), row.begin() + degree, neighbors.begin() + offsets[src]));
+	}
+}
+
+TEST(Topology, Fingerprint) {
+	adj_list a;
+	a.connect(0, 1);
+	a(2, 2);
+	ASSERT_FALSE(a.fingerprint({1}).empty());
+	ASSERT_EQ(a.fingerprint({1}), a.fingerprint({2}));
+	adj_list b = a;
+	ASSERT_EQ(a.fingerprint({1}), b.fingerprint({1}));
+
+	b.connect(1, 0);
+	ASSERT_NE(a.fingerprint({1}), b.fingerprint({1}));
+	// Identical edges, but not provably so
+	a.connect(1, 0);
+	ASSERT_NE(a.fingerprint({1}), b.fingerprint({1}));
+
+	// Edits since the last fingerprint are batched, but still change it
+	auto const before = a.fingerprint({1});
+	for (Int i : range(10))
+		a.connect(i, 0);
+	ASSERT_NE(a.fingerprint({1}), before);
+	ASSERT_EQ(a.fingerprint({1}), a.fingerprint({1}));
+
+	fixed_probability f(0.1);
+	ASSERT_TRUE(f(10, 20).fingerprint({1}).empty());
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "spice/util/checkpoint.h"
+#include "spice/util/stdint.h"
+
+using namespace spice;
+using namespace spice::util;
+
+static std::string const path =
+    (std::filesystem::temp_directory_path() / "spice_checkpoint_test.ckpt").string();
+
+TEST(Checkpoint, RoundTrip) {
+	std::vector<Int32> values{1, 2, 3};
+	std::vector<std::vector<UInt16>> nested{{4, 5}, {}, {6}};
+	{
+		checkpoint_writer out(path);
+		out.write_value(Int(42));
+		out.write(values);
+		out.write(nested);
+		out.write(std::vector<float>{});
+		ASSERT_EQ(out.sections(), 5);
+		out.close();
+	}
+
+	checkpoint_reader in(path);
+	ASSERT_EQ(in.sections(), 5);
+	ASSERT_EQ(in.read_value<Int>(), 42);
+
+	// Sections are aligned and can be accessed in place, in any order
+	in.seek(4);
+	ASSERT_TRUE(in.section<float>().empty());
+	in.seek(1);
+	auto const view = in.section<Int32>();
+	ASSERT_EQ(reinterpret_cast<UInt>(view.data()) % checkpoint_alignment, 0);
+	ASSERT_EQ(std::vector(view.begin(), view.end()), values);
+
+	std::vector<std::vector<UInt16>> nested2;
+	in.read(nested2);
+	ASSERT_EQ(nested2, nested);
+
+	in.seek(1);
+	std::vector<Int32> too_small(2);
+	ASSERT_THROW(in.read(std::span(too_small)), std::runtime_error);
+	in.seek(1);
+	ASSERT_THROW(in.section<Int>(), std::runtime_error); // 12 bytes
+	in.seek(5);
+	ASSERT_THROW(in.section(), std::runtime_error);
+
+	std::remove(path.c_str());
+}
+
+TEST(Checkpoint, Errors) {
+	ASSERT_THROW(checkpoint_reader("/nonexistent/network.ckpt"), std::system_error);
+	ASSERT_THROW(checkpoint_writer("/nonexistent/network.ckpt"), std::system_error);
+
+	std::FILE* const file = std::fopen(path.c_str(), "wb");
+	std::fputs("not a checkpoint", file);
+	std::fclose(file);
+	ASSERT_THROW(checkpoint_reader{path}, std::runtime_error);
+
+	{
+		checkpoint_writer out(path);
+		out.write(std::vector<Int>(100));
+		out.close();
+	}
+	std::filesystem::resize_file(path, 200);
+	ASSERT_THROW(checkpoint_reader{path}, std::runtime_error);
+
+	std::remove(path.c_str());
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "spice/util/numa.h"
+#include "spice/util/range.h"
+
+using namespace spice;
+using namespace spice::util;
+
+TEST(NUMA, NodeCount) { ASSERT_GE(numa_node_count(), 1); }
+
+TEST(NUMA, Place) {
+	for (auto policy : {numa_policy::interleave, numa_policy::partition, numa_policy::local}) {
+		std::vector<float> buffer(1 << 20, 1.0f);
+		numa_place(std::span(buffer), policy);
+		ASSERT_EQ(std::accumulate(buffer.begin(), buffer.end(), 0.0), buffer.size());
+
+		auto const p = numa_pages("buffer", std::span(buffer));
+		ASSERT_EQ(p.buffer, "buffer");
+		ASSERT_EQ(p.pages.size(), numa_node_count());
+
+		// All pages are resident, plus up to two partially covered ones
+		Int const pages = std::accumulate(p.pages.begin(), p.pages.end(), Int(0));
+		Int const page  = sysconf(_SC_PAGESIZE);
+		if (pages > 0) {
+			ASSERT_GE(pages, buffer.size() * sizeof(float) / page);
+			ASSERT_LE(pages, buffer.size() * sizeof(float) / page + 2);
+		}
+	}
+}
+
+TEST(NUMA, Pin) {
+	std::thread t([] {
+		for (Int node : range(numa_node_count()))
+			numa_pin(pthread_self(), node);
+	});
+	t.join();
+}
+
+TEST(NUMA, ParseCpulist) {
+	using v = std::vector<Int>;
+	ASSERT_EQ(parse_cpulist(""), v{});
+	ASSERT_EQ(parse_cpulist("\n"), v{});
+	ASSERT_EQ(parse_cpulist(" ,\n"), v{});
+	ASSERT_EQ(parse_cpulist("3\n"), v{3});
+	ASSERT_EQ(parse_cpulist("0-3,8-9\n"), (v{0, 1, 2, 3, 8, 9}));
+	ASSERT_EQ(parse_cpulist("0-1,,x,5\n"), (v{0, 1, 5}));
+}
+
+TEST(NUMA, Cpus) {
+	for (Int node : range(numa_node_count()))
+		for (Int cpu : numa_cpus(node))
+			ASSERT_GE(cpu, 0);
+}
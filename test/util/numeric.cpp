@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <cmath>
+
 #include "spice/util/numeric.h"
 #include "spice/util/range.h"
 #include "spice/util/stdint.h"
@@ -26,4 +28,59 @@ TEST(KahanSum, Add) {
 	ASSERT_NE(sum, 1);
 	ASSERT_EQ(ksum, 1);
 	ASSERT_EQ(deltas, 1);
+}
+
+// Relative rounding error of a type with the given number of significant bits
+static float epsilon(Int const bits) { return std::ldexp(1.0f, -bits); }
+
+TEST(Compact, Float16) {
+	static_assert(sizeof(float16) == 2);
+
+	for (float x : {0.0f, 1.0f, -2.5f, 1e-3f, 3.14159f, 65504.0f})
+		ASSERT_NEAR(float16(x), x, std::abs(x) * epsilon(11)) << x;
+
+	float16 x = 1;
+	x += 0.5f;
+	x *= 2;
+	x -= 1;
+	x /= 4;
+	ASSERT_EQ(x, 0.5f);
+
+	// 1 + 2^-11 lies halfway between 1 and the next float16, 1 + 2^-10
+	ASSERT_EQ(float16(1 + epsilon(11)), 1.0f);
+	ASSERT_EQ(float16(1 + epsilon(11) * 1.5f), 1 + epsilon(10));
+}
+
+TEST(Compact, BFloat16) {
+	static_assert(sizeof(bfloat16) == 2);
+
+	for (float x : {0.0f, 1.0f, -2.5f, 1e-3f, 3.14159f, 1e30f, -1e-30f})
+		ASSERT_NEAR(bfloat16(x), x, std::abs(x) * epsilon(8)) << x;
+
+	// Ties round to even
+	ASSERT_EQ(bfloat16(1 + epsilon(8)), 1.0f);
+	ASSERT_EQ(bfloat16(1 + 3 * epsilon(8)), 1 + 4 * epsilon(8));
+
+	bfloat16 x = 3;
+	x -= 1;
+	ASSERT_EQ(x, 2.0f);
+}
+
+TEST(Compact, Fixed) {
+	using weight = fixed<UInt16, 3e-4f / 65535>;
+	static_assert(sizeof(weight) == 2);
+
+	for (float x : {0.0f, 1e-4f, 1.234e-4f, 3e-4f})
+		ASSERT_NEAR(weight(x), x, 3e-4f / 65535 / 2) << x;
+
+	// Saturates
+	ASSERT_EQ(weight(-1), 0.0f);
+	ASSERT_FLOAT_EQ(weight(1), 3e-4f);
+
+	using signed_byte = fixed<Int8, 0.5f>;
+	ASSERT_EQ(signed_byte(-100), -64.0f);
+	ASSERT_EQ(signed_byte(1.2f), 1.0f);
+	signed_byte x = 2;
+	x += 0.5f;
+	ASSERT_EQ(x, 2.5f);
 }
\ No newline at end of file
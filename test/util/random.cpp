@@ -1,6 +1,9 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <numbers>
+#include <span>
+#include <vector>
 
 #include "spice/util/random.h"
 #include "spice/util/range.h"
@@ -97,6 +100,114 @@ TEST(Random, Xoroshiro64_128_UniformRealDistributionDoubleTrue) {
 	                                                  uniform_real_distribution<double, true>(1, 3),
 	                                                  1, 3);
 }
+TEST(Random, Philox_UniformRealDistributionFloat) {
+	test_random_number_distribution<philox4x32_10>([](double x) { return 0.5 * x - 0.5; },
+	                                               uniform_real_distribution<float>(1, 3), 1, 3);
+}
+TEST(Random, Philox_UniformRealDistributionDouble) {
+	test_random_number_distribution<philox4x32_10>(
+	    [](double x) { return 0.5 * x - 0.5; }, uniform_real_distribution<double>(1, 3), 1, 3);
+}
+
+// Known-answer tests from the Random123 reference implementation
+TEST(Random, PhiloxKAT) {
+	using ctr = philox4x32_10::counter_t;
+	ASSERT_EQ(philox4x32_10::block({0, 0, 0, 0}, {0, 0}),
+	          (ctr{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+	ASSERT_EQ(philox4x32_10::block({~0u, ~0u, ~0u, ~0u}, {~0u, ~0u}),
+	          (ctr{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+	ASSERT_EQ(philox4x32_10::block({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+	                               {0xa4093822, 0x299f31d0}),
+	          (ctr{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(Random, PhiloxStreams) {
+	seed_seq const seed({1337});
+
+	// Streams are reproducible and don't depend on each other
+	philox4x32_10 a(seed, 7), b(seed, 7), c(seed, 8);
+	for (Int i : range(9)) {
+		UInt const x = a();
+		ASSERT_EQ(x, b());
+		ASSERT_NE(x, c());
+		(void)i;
+	}
+	ASSERT_NE(philox4x32_10(seed, 7)(), philox4x32_10(seed_seq({1338}), 7)());
+}
+
+TEST(Random, XoroshiroLanes) {
+	seed_seq const seed({1337});
+
+	// Lane l reproduces the scalar generator seeded with stream l
+	xoroshiro64_128p_lanes<4> lanes(seed);
+	std::vector<xoroshiro64_128p> scalar;
+	for (Int l : range(4))
+		scalar.emplace_back(seed.stream(l));
+
+	for (Int i : range(9)) {
+		auto const x = lanes();
+		for (Int l : range(4))
+			ASSERT_EQ(x[l], scalar[l]());
+		(void)i;
+	}
+}
+
+// Same as test_random_number_distribution(), but draws all samples at once via the batch
+// interface. An odd number of samples exercises the generators' remainder handling.
+template <class RNG, class Real>
+void test_batch_distribution(auto const& cdf, auto&& dist, double const a, double const b) {
+	auto const seed = std::random_device()();
+	RNG rng({seed});
+
+	std::vector<Real> samples(100'003);
+	dist(rng, std::span(samples));
+	std::sort(samples.begin(), samples.end());
+
+	double kolmogorov_smirnov = 0;
+	for (Int i : range(100)) {
+		double const x = std::lerp(a, b, i * 0.01);
+		Int const is   = std::upper_bound(samples.begin(), samples.end(), x) - samples.begin();
+		kolmogorov_smirnov =
+		    std::max(kolmogorov_smirnov, std::abs(double(is) / samples.size() - cdf(x)));
+	}
+
+	EXPECT_LE(kolmogorov_smirnov, 0.01) << "failing seed: " << seed;
+}
+
+TEST(Random, BatchUniformRealDistribution) {
+	auto const cdf = [](double x) { return 0.5 * x - 0.5; };
+	test_batch_distribution<xoroshiro64_128p_lanes<4>, float>(
+	    cdf, uniform_real_distribution<float>(1, 3), 1, 3);
+	test_batch_distribution<xoroshiro64_128p_lanes<4>, float>(
+	    cdf, uniform_real_distribution<float, true>(1, 3), 1, 3);
+	test_batch_distribution<xoroshiro64_128p_lanes<2>, double>(
+	    cdf, uniform_real_distribution<double>(1, 3), 1, 3);
+	test_batch_distribution<xoroshiro64_128p_lanes<2>, double>(
+	    cdf, uniform_real_distribution<double, true>(1, 3), 1, 3);
+	test_batch_distribution<xoroshiro64_128p, float>(cdf, uniform_real_distribution<float>(1, 3),
+	                                                 1, 3);
+}
+
+TEST(Random, BatchExponentialDistribution) {
+	auto const cdf = [](double x) { return 1 - std::exp(-5 * x); };
+	test_batch_distribution<xoroshiro64_128p_lanes<4>, float>(
+	    cdf, exponential_distribution<float>(0.2), 0, 1);
+	test_batch_distribution<xoroshiro64_128p_lanes<4>, double>(
+	    cdf, exponential_distribution<double>(0.2), 0, 1);
+}
+
+TEST(Random, BatchCanonicalInterval) {
+	xoroshiro64_128p_lanes<4> rng({1337});
+	std::vector<float> x(10'001);
+
+	generate_canonical<float>(rng, std::span(x));
+	for (float f : x)
+		ASSERT_TRUE(0 <= f && f < 1);
+
+	generate_canonical<float, true>(rng, std::span(x));
+	for (float f : x)
+		ASSERT_TRUE(0 < f && f <= 1);
+}
 
 TEST(Random, ExponentialDistribution) {
 	test_random_number_distribution<xoroshiro64_128p>([](double x) { return 1 - std::exp(-5 * x); },
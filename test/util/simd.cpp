@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "spice/util/range.h"
+#include "spice/util/simd.h"
+#include "spice/util/stdint.h"
+
+using namespace spice;
+using namespace spice::util;
+
+TEST(SIMD, LoadStore) {
+	float x[simd_width + 1];
+	for (Int i : range(simd_width + 1))
+		x[i] = i;
+
+	simd<float> const v = load(x + 1);
+	for (Int l : range(simd_width))
+		ASSERT_EQ(v[l], l + 1);
+
+	store(x, v * 2);
+	for (Int l : range(simd_width))
+		ASSERT_EQ(x[l], 2 * (l + 1));
+}
+
+TEST(SIMD, ToBitmask) {
+	simd<float> v{};
+	v[1] = 1;
+	v[6] = 1;
+	ASSERT_EQ(to_bitmask(v > 0), 0b0100'0010u);
+	ASSERT_EQ(to_bitmask(v < 0), 0u);
+	ASSERT_EQ(to_bitmask(v >= 0), 0xFFu);
+}
+
+TEST(SIMD, Compress) {
+	for (UInt32 mask = 0; mask < (1u << simd_width); mask++) {
+		std::vector<Int32> expected;
+		for (Int l : range(simd_width))
+			if (mask & (1u << l))
+				expected.push_back(100 + l);
+
+		Int32 out[simd_width];
+		Int const n = compress(mask, 100, out);
+		ASSERT_EQ(std::vector<Int32>(out, out + n), expected) << mask;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "spice/util/range.h"
+#include "spice/util/soa.h"
+#include "spice/util/stdint.h"
+
+using namespace spice;
+using namespace spice::util;
+
+struct point {
+	float x  = 1;
+	Int32 y  = 2;
+	double z  = 3;
+};
+BOOST_HANA_ADAPT_STRUCT(point, x, y, z);
+static_assert(Reflectable<point>);
+static_assert(field_count<point> == 3);
+static_assert(std::is_same_v<field_t<point, 1>, Int32>);
+
+TEST(SoA, Resize) {
+	soa_vector<point> v(3);
+	ASSERT_EQ(v.size(), 3);
+	for (Int i : range(3)) {
+		ASSERT_EQ(v.load(i).x, 1);
+		ASSERT_EQ(v.load(i).y, 2);
+		ASSERT_EQ(v.load(i).z, 3);
+	}
+
+	v.resize(5);
+	ASSERT_EQ(v.size(), 5);
+	ASSERT_EQ(v.field<2>().size(), 5);
+	ASSERT_EQ(v.field<2>()[4], 3);
+}
+
+TEST(SoA, LoadStore) {
+	soa_vector<point> v(4);
+	v.store(2, {4, 5, 6});
+
+	ASSERT_EQ(v.field<0>()[2], 4);
+	ASSERT_EQ(v.field<1>()[2], 5);
+	ASSERT_EQ(v.field<2>()[2], 6);
+	ASSERT_EQ(v.field<1>()[1], 2);
+
+	point const p = v[2];
+	ASSERT_EQ(p.x, 4);
+	ASSERT_EQ(p.y, 5);
+	ASSERT_EQ(p.z, 6);
+
+	v[3] = p;
+	ASSERT_EQ(v.load(3).y, 5);
+
+	v[1][BOOST_HANA_STRING("y")] = 42;
+	ASSERT_EQ(v.field<1>()[1], 42);
+	ASSERT_EQ(v.load(1).x, 1);
+}
+
+TEST(SoA, ApplyAt) {
+	soa_vector<point> v(2);
+	apply_at(v, 1, [](point& p) { p.y = 7; });
+	ASSERT_EQ(v.load(0).y, 2);
+	ASSERT_EQ(v.load(1).y, 7);
+
+	std::vector<point> aos(2);
+	apply_at(std::span(aos), 1, [](point& p) { p.y = 7; });
+	ASSERT_EQ(aos[1].y, 7);
+}
+
+TEST(SoA, Fields) {
+	soa_vector<point> v(3);
+	std::vector<std::string> names;
+	v.for_each_field([&](char const* name, auto field) {
+		names.push_back(name);
+		ASSERT_EQ(field.size(), 3);
+	});
+	ASSERT_EQ(names, (std::vector<std::string>{"x", "y", "z"}));
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+
+#include <mutex>
+#include <stdexcept>
+
+#include "spice/util/range.h"
+#include "spice/util/task_graph.h"
+
+using namespace spice;
+using namespace spice::util;
+
+TEST(TaskGraph, Build) {
+	task_graph g;
+	ASSERT_EQ(g.size(), 0);
+
+	ASSERT_EQ(g.add(), 0);
+	ASSERT_EQ(g.add(), 1);
+	ASSERT_EQ(g.add(), 2);
+
+	g.precede(0, 2);
+	g.precede(1, 2);
+	g.precede(1, 2);
+
+	ASSERT_EQ(g.size(), 3);
+	ASSERT_EQ(g.successors(0), std::vector<Int>{2});
+	ASSERT_EQ(g.successors(1), std::vector<Int>{2});
+	ASSERT_EQ(g.predecessor_count(0), 0);
+	ASSERT_EQ(g.predecessor_count(2), 2);
+}
+
+TEST(TaskGraph, Empty) {
+	task_graph g;
+	thread_pool pool(2);
+	g.run(pool, [](Int) { FAIL(); });
+}
+
+TEST(TaskGraph, Run) {
+	// Diamonds chained together: 0 -> {1, 2} -> 3 -> {4, 5} -> 6 ...
+	task_graph g;
+	Int const N = 30;
+	for (Int i : range(3 * N + 1)) {
+		g.add();
+		(void)i;
+	}
+	for (Int i : range(N)) {
+		g.precede(3 * i, 3 * i + 1);
+		g.precede(3 * i, 3 * i + 2);
+		g.precede(3 * i + 1, 3 * i + 3);
+		g.precede(3 * i + 2, 3 * i + 3);
+	}
+
+	for (Int threads : {1, 2, 5}) {
+		thread_pool pool(threads);
+
+		for (Int rep : range(10)) {
+			std::mutex mtx;
+			std::vector<Int> order;
+			g.run(pool, [&](Int i) {
+				std::lock_guard _(mtx);
+				order.push_back(i);
+			});
+
+			ASSERT_EQ(order.size(), g.size());
+
+			std::vector<Int> pos(g.size());
+			for (Int i : range(order))
+				pos[order[i]] = i;
+
+			for (Int i : range(g.size()))
+				for (Int succ : g.successors(i))
+					ASSERT_LT(pos[i], pos[succ]);
+
+			(void)rep;
+		}
+	}
+}
+
+TEST(TaskGraph, Nested) {
+	task_graph g;
+	g.add();
+	g.add();
+	g.precede(0, 1);
+
+	thread_pool pool(3);
+	std::vector<Int> x(100);
+	g.run(pool, [&](Int i) { pool.parallel_for(100, [&](Int j) { x[j] = x[j] * 2 + i + 1; }); });
+
+	for (Int i : range(x))
+		ASSERT_EQ(x[i], 4);
+}
+
+TEST(TaskGraph, Exception) {
+	task_graph g;
+	g.add();
+	g.add();
+	g.precede(0, 1);
+
+	thread_pool pool(2);
+	Int count = 0;
+	ASSERT_THROW(g.run(pool,
+	                   [&](Int i) {
+		                   count++;
+		                   if (i == 0)
+			                   throw std::logic_error("");
+	                   }),
+	             std::logic_error);
+	ASSERT_EQ(count, 2);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+
+#include <numeric>
+#include <stdexcept>
+
+#include "spice/util/range.h"
+#include "spice/util/thread_pool.h"
+
+using namespace spice;
+using namespace spice::util;
+
+TEST(ThreadPool, Size) {
+	ASSERT_EQ(thread_pool().size(), 1);
+	ASSERT_EQ(thread_pool(4).size(), 4);
+}
+
+TEST(ThreadPool, ParallelFor) {
+	for (Int threads : {1, 2, 7}) {
+		thread_pool pool(threads);
+
+		for (Int n : {0, 1, 3, 1000}) {
+			std::vector<Int> x(n);
+			pool.parallel_for(n, [&](Int i) { x[i] += i; });
+
+			for (Int i : range(n))
+				ASSERT_EQ(x[i], i);
+		}
+	}
+}
+
+TEST(ThreadPool, Nested) {
+	thread_pool pool(4);
+
+	std::vector<Int> x(100 * 100);
+	pool.parallel_for(100, [&](Int i) {
+		pool.parallel_for(100, [&](Int j) { x[i * 100 + j] = i * 100 + j; });
+	});
+
+	for (Int i : range(x))
+		ASSERT_EQ(x[i], i);
+}
+
+TEST(ThreadPool, Reuse) {
+	thread_pool pool(3);
+
+	std::atomic<Int> sum = 0;
+	for (Int i : range(1000)) {
+		pool.parallel_for(8, [&](Int j) { sum += j; });
+		(void)i;
+	}
+
+	ASSERT_EQ(sum, 1000 * 28);
+}
+
+TEST(ThreadPool, Exception) {
+	thread_pool pool(4);
+
+	ASSERT_THROW(pool.parallel_for(100,
+	                               [](Int i) {
+		                               if (i == 42)
+			                               throw std::logic_error("");
+	                               }),
+	             std::logic_error);
+
+	// The pool remains usable
+	Int count = 0;
+	pool.parallel_for(1, [&](Int) { count++; });
+	ASSERT_EQ(count, 1);
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "spice/util/range.h"
+#include "spice/util/transport.h"
+
+using namespace spice;
+using namespace spice::util;
+
+TEST(Transport, AllGather) {
+	auto comm = socket_transport::fork(3);
+
+	// Large enough to exceed the sockets' buffers
+	auto const size = [](Int const rank, Int const round) { return rank * 300'000 + round; };
+
+	bool ok = comm->size() == 3;
+	std::vector<std::vector<std::byte>> recv;
+	for (Int round : range(3)) {
+		std::vector<std::byte> send(size(comm->rank(), round), std::byte(comm->rank()));
+		comm->all_gather(send, recv);
+
+		ok &= recv.size() == 3;
+		for (Int r : range(recv))
+			ok &= recv[r].size() == size(r, round) &&
+			      std::all_of(recv[r].begin(), recv[r].end(),
+			                  [&](std::byte const b) { return b == std::byte(r); });
+	}
+
+	if (comm->rank() != 0)
+		std::_Exit(0);
+
+	ASSERT_TRUE(ok);
+	ASSERT_EQ(comm->statistics().exchanges, 3);
+	ASSERT_GT(comm->statistics().bytes, 0);
+}